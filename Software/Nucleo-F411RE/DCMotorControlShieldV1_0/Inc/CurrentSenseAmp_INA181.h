@@ -20,6 +20,8 @@ extern "C" {
 #endif
 
 /* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
 /* Include user header files -------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /* Exported types ------------------------------------------------------------*/
@@ -28,6 +30,8 @@ extern "C" {
 /* Exported variables --------------------------------------------------------*/
 /* Exported function prototypes ----------------------------------------------*/
 float readCurrentResponse(void);
+int32_t readCurrentResponseCount(void);
+float getCurrentResponseResolution(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file    DOB.h
+ * @brief   Header file of disturbance observer and reaction torque observer
+ * @details Disturbance current is estimated from current and velocity response of nominal model Ktn/(Mn*s) :
+ *          Id = Gdob/(s + Gdob) * (I + (Mn/Ktn)*Gdob*v) - (Mn/Ktn)*Gdob*v
+ *          The low-pass filter is discretized when coefficients are set,
+ *          so one observer step costs only three multiply-adds.
+ *          - Disturbance observer : I is current command, Id is added to current reference to cancel disturbance
+ *          - Reaction torque observer : I is current response, Ktn*Id minus friction model is the external load torque
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DOB_H
+#define __DOB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+/**
+ * @brief       Coefficients of disturbance observer (low-pass filter is discretized by backward Euler)
+ * @param       Gdob Cutoff frequency [rad/s]
+ * @param       M Nominal inertia [Nm/s^2*rad]
+ * @param       Kt Nominal torque constant [Nm/A]
+ * @param       Ts Sampling time [s]
+ */
+#define DOB_COEFFS(Gdob, M, Kt, Ts)                 \
+    {                                               \
+        (M) / (Kt) * (Gdob),                        \
+        1.0f / (1.0f + (Gdob) * (Ts)),              \
+        (Gdob) * (Ts) / (1.0f + (Gdob) * (Ts))      \
+    }
+
+/**
+ * @brief       Coefficients of reaction torque observer
+ * @param       Gdob Cutoff frequency [rad/s]
+ * @param       M Nominal inertia [Nm/s^2*rad]
+ * @param       Kt Nominal torque constant [Nm/A]
+ * @param       Coulomb Coulomb friction torque [Nm]
+ * @param       Viscous Viscous friction coefficient [Nm*s/rad]
+ * @param       VelocityBand Velocity where Coulomb friction is saturated (> 0) [rad/s]
+ * @param       Ts Sampling time [s]
+ */
+#define RTOB_COEFFS(Gdob, M, Kt, Coulomb, Viscous, VelocityBand, Ts) \
+    { DOB_COEFFS(Gdob, M, Kt, Ts), (Kt), (Coulomb), (Viscous), 1.0f / (VelocityBand) }
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct DOBCoeffs
+ * Coefficients of disturbance observer
+ */
+typedef struct
+{
+    float K;            ///< (Mn/Ktn)*Gdob : velocity to current [A*s/rad]
+    float A;            ///< Pole of low-pass filter : 1/(1 + Gdob*Ts)
+    float B;            ///< Gain of low-pass filter : Gdob*Ts/(1 + Gdob*Ts)
+} DOBCoeffs;
+
+/**
+ * @struct RTOBCoeffs
+ * Coefficients of reaction torque observer
+ */
+typedef struct
+{
+    DOBCoeffs Observer;     ///< Coefficients of disturbance estimation
+    float Kt;               ///< Nominal torque constant [Nm/A]
+    float Coulomb;          ///< Coulomb friction torque [Nm]
+    float Viscous;          ///< Viscous friction coefficient [Nm*s/rad]
+    float InvVelocityBand;  ///< 1/(velocity where Coulomb friction is saturated) [s/rad]
+} RTOBCoeffs;
+
+/**
+ * @struct DOBState
+ * State of disturbance observer
+ */
+typedef struct
+{
+    float Filter;       ///< Output of low-pass filter [A]
+    float CurrentCmd;   ///< Compensated current command (DOB) or current response (RTOB) of previous step [A]
+    float Disturbance;  ///< Current which cancels estimated disturbance [A]
+} DOBState;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void setDOBCoeffs(DOBCoeffs*, float, float, float, float);
+void resetDOB(const DOBCoeffs*, DOBState*, float);
+float calcDOB(const DOBCoeffs*, DOBState*, float, float);
+
+void setRTOBCoeffs(RTOBCoeffs*, float, float, float, float, float, float, float);
+float calcRTOB(const RTOBCoeffs*, DOBState*, float, float);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DOB_H */
+/***************************************************************END OF FILE****/
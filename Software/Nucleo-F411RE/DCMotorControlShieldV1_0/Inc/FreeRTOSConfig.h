@@ -155,7 +155,7 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 header file. */
 /* USER CODE BEGIN 1 */   
 #undef configTICK_RATE_HZ
-#define configTICK_RATE_HZ                       ((TickType_t)20000)// change also FreeRTOS_PERIOD_HZ in main.h
+#define configTICK_RATE_HZ                       ((TickType_t)FreeRTOS_PERIOD_HZ)// FreeRTOS_PERIOD_HZ is defined in main.h
 #define configASSERT( x ) if ((x) == 0) {taskDISABLE_INTERRUPTS(); for( ;; );} 
 /* USER CODE END 1 */
 
@@ -20,6 +20,8 @@ extern "C" {
 #endif
 
 /* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
 /* Include user header files -------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /********** Hardware-specific parameters **********/
@@ -27,11 +29,29 @@ extern "C" {
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum MotorOutputState
+ * Output state of motor driver
+ */
+typedef enum
+{
+    Coast_MotorOutput = 0,      ///< Coast (AIN1 = L, AIN2 = L, output is high impedance)
+    ShortBrake_MotorOutput,     ///< Short brake (AIN1 = H, AIN2 = H)
+    Forward_MotorOutput,        ///< Drive with positive voltage (AIN1 = H, AIN2 = L, PWM)
+    Reverse_MotorOutput         ///< Drive with negative voltage (AIN1 = L, AIN2 = H, PWM)
+} MotorOutputState;
+
 /* Exported struct/union tag -------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
 /* Exported function prototypes ----------------------------------------------*/
+void initMotorDriver(void);
 void setMotorVoltage(float);
+void setMotorPulse(int32_t);
+int32_t getMaxMotorPulse(void);
+float getMotorPulsePerVoltage(void);
 void stopMotor(void);
+void coastMotor(void);
+MotorOutputState getMotorOutputState(void);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,23 @@
  ******************************************************************************
  * @file    RotaryEncoder_AS5600.h
  * @brief   Header file of 12-Bit programmable contactless potentiometer AS5600
+ * @details Reads of the angle are started by the sampling timer (TIM4, synchronized with TIM3 PWM),
+ *          so the sampling period and its phase to the control loops are constant regardless of the loop execution.
+ *          Each completed read is stored with the time when it was started in a ring buffer,
+ *          and the control loop reads the latest sample with its age.
+ *          The periodic read (register 0x0C, repeated start, 2 bytes) is executed by a register-level driver
+ *          with I2C event and DMA interrupts only (HAL I2C is used for initialization).
+ *          When a read fails or times out, the bus is recovered one step per sampling period (SCL clocks and STOP by GPIO,
+ *          then reset of I2C peripheral), and the last good sample is held with increasing age.
+ *          If no sample is stored for AS5600_FAULT_MISSED_SAMPLES periods, the health becomes Fault
+ *          and the control loop must stop the motor (see getEncoderHealth()).
+ *          If USE_ENCODER_ANALOG_OUTPUT is enabled, the analog output (10% ~ 90% of VDD) is sampled by ADC1
+ *          with current response every PWM period instead, and the I2C read is used only for diagnostics
+ *          until the analog output goes out of range (then I2C is used for position response again,
+ *          until the analog output agrees with I2C read for 20[ms]).
+ *          The OUT pin is not connected to the ADC on the base PCB (see USE_ENCODER_ANALOG_OUTPUT in main.h).
+ *          The angle is corrected by the table stored in flash sector 1 (see writeEncoderCorrectionTable())
+ *          before multi-turn counting, so all samples include the correction.
  * @version 1.0
  *
  * @par License
@@ -20,16 +37,77 @@ extern "C" {
 #endif
 
 /* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
 /* Include user header files -------------------------------------------------*/
+#include "main.h"   // USE_ENCODER_ANALOG_OUTPUT
 /* Exported macro ------------------------------------------------------------*/
+#define AS5600_SAMPLE_BUFFER_SIZE   8   ///< Number of samples kept in ring buffer (power of 2)
+#define ENCODER_CORRECTION_TABLE_SIZE 4096  ///< Elements of correction table (counts per revolution)
+#define AS5600_FAULT_MISSED_SAMPLES 50  ///< Health becomes Fault after this number of sampling periods without sample (10[ms] at 5[kHz])
+
 /* Exported types ------------------------------------------------------------*/
 /* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum EncoderHealth
+ * Health of encoder (updated every sampling period)
+ */
+typedef enum
+{
+    Healthy_EncoderHealth = 0,  ///< A sample was stored in the last sampling period
+    Holding_EncoderHealth,      ///< Samples are missing, the last good sample is held (bus is being recovered)
+    Fault_EncoderHealth         ///< Samples have been missing for AS5600_FAULT_MISSED_SAMPLES periods, or initialization failed
+} EncoderHealth;
+
 /* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct EncoderSample
+ * Position response with its timestamp
+ */
+typedef struct
+{
+    int32_t Count;          ///< Position response [count] (changed by setPositionResponse)
+    uint32_t AbsoluteCount; ///< Free-running count (not changed by setPositionResponse, wraps around)
+    uint32_t Timestamp;     ///< Time when the read was started by the sampling timer [cycle] (see getEncoderTimestampFrequency())
+    uint32_t Age;           ///< Elapsed time from Timestamp to the call of readEncoderSample [cycle]
+    uint16_t Angle;         ///< Single-turn angle after correction (index of correction table) [count]
+} EncoderSample;
+
+/**
+ * @struct EncoderErrorStats
+ * Error statistics of encoder (counted since initialization)
+ */
+typedef struct
+{
+    uint32_t BusErrors;         ///< Bus error, arbitration lost, overrun or SMBus timeout of periodic read
+    uint32_t Nacks;             ///< Address or data not acknowledged
+    uint32_t DMAErrors;         ///< DMA transfer error
+    uint32_t Timeouts;          ///< Read not completed (or bus busy) for AS5600_READ_TIMEOUT_PERIODS sampling periods
+    uint32_t Recoveries;        ///< Bus recoveries
+    uint32_t Faults;            ///< Transitions to Fault
+    uint32_t MissedSamples;     ///< Present number of sampling periods without sample (age of held sample)
+    uint32_t MaxMissedSamples;  ///< Longest run of missed samples
+} EncoderErrorStats;
+
 /* Exported variables --------------------------------------------------------*/
 /* Exported function prototypes ----------------------------------------------*/
 void initEncoder(void);
 int readPositionResponse(float*);
-void setPositionResponse(float, float*);
+int readPositionResponseCount(int32_t*);
+int readEncoderSample(EncoderSample*);
+int readEncoderSampleHistory(EncoderSample*, uint32_t);
+void setPositionResponse(float);
+float getPositionResponseResolution(void);
+float getEncoderTimestampFrequency(void);
+int writeEncoderCorrectionTable(const int8_t*);
+void enableEncoderCorrection(bool);
+EncoderHealth getEncoderHealth(void);
+void readEncoderErrorStats(EncoderErrorStats*);
+#if USE_ENCODER_ANALOG_OUTPUT
+void AS5600_ADC_ConvCpltCallback(uint16_t);
+int readEncoderAnalogDeviation(int16_t*);
+#endif
 
 #ifdef __cplusplus
 }
@@ -60,14 +60,36 @@
 /* USER CODE BEGIN Includes */
 #include <stdint.h>
 
-extern volatile uint16_t ADC1Value[5];
-extern volatile float CurrentPinVoltage;
+/**
+ * @struct ADC1Data
+ * Converted values of one ADC1 conversion sequence
+ */
+typedef struct
+{
+    uint16_t CurrentPinCount;           ///< Raw ADC count of current sense amp output
+    float CurrentPinVoltage;            ///< Voltage of current sense amp output [V] (not converted if USE_FIXED_POINT_CONTROL)
+    float Param1, Param2, Param3, Param4; ///< Values of variable resistors (0.0 ~ 1.0) (not converted if USE_FIXED_POINT_CONTROL)
+#if USE_ENCODER_ANALOG_OUTPUT
+    uint16_t EncoderPinCount;           ///< Raw ADC count of AS5600 analog output
+#endif
+} ADC1Data;
+
+#if USE_ENCODER_ANALOG_OUTPUT
+#define ADC1_NUM_CONVERSIONS    6       // Current, Param1-4, AS5600 analog output
+#else
+#define ADC1_NUM_CONVERSIONS    5       // Current, Param1-4
+#endif
+
+extern volatile uint16_t ADC1Value[ADC1_NUM_CONVERSIONS];
 extern volatile float Param1, Param2, Param3, Param4;
 /* USER CODE END Includes */
 
 extern ADC_HandleTypeDef hadc1;
 
 /* USER CODE BEGIN Private defines */
+/**************** System parameters ***************/
+#define ADC_RESOLUTION      4096    // 12-bit
+#define ADC_VCC             3.3f    // [V]          Supply voltage of ADC
 /* USER CODE END Private defines */
 
 extern void _Error_Handler(char *, int);
@@ -76,6 +98,7 @@ void MX_ADC1_Init(void);
 
 /* USER CODE BEGIN Prototypes */
 void ADC1_ConvCpltCallback(ADC_HandleTypeDef*);
+void readADC1Data(ADC1Data*);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
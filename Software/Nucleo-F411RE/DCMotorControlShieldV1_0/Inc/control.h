@@ -20,12 +20,90 @@ extern "C" {
 #endif
 
 /* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
 /* Include user header files -------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /**************** System parameters ***************/
 #define dt_minor    0.000050f       ///< Sampling time of minor loop [sec]
 #define dt_major    0.000200f       ///< Sampling time of major loop [sec]
-#define DIVERGENCE_THRESHOLD_MS 300 ///< Threshold time to detect divergence [msec]
+#define MINOR_LOOPS_PER_MAJOR_LOOP 4 ///< Number of minor loop periods in one major loop period
+#define USE_FIXED_POINT_CONTROL 0   ///< 1: Fixed-point controllers on raw counts (control_fixed.c), 0: Floating-point controllers
+#define USE_CMSIS_DSP_CONTROL   0   ///< 1: Floating-point controllers use CMSIS-DSP kernels (control_kernel.c), 0: Controllers of controller.h
+#define USE_MOTION_PLANNER      0   ///< 1: Position command from motion planner (point-to-point demo), 0: Periodic trajectory demo
+#define USE_CONSTANT_GAINS      0   ///< 1: Gains are fixed to *_DEFAULT and discretized at compile time (gain arguments are ignored), 0: Gains can be changed at runtime
+#define USE_DISTURBANCE_OBSERVER 0  ///< 1: Current command is compensated by disturbance observer (DOB.c, floating-point controllers only), 0: Not used
+#define USE_REACTION_TORQUE_OBSERVER 1 ///< 1: External load torque is estimated by reaction torque observer (DOB.c) for telemetry, 0: Not used
+#define USE_ACCELERATION_FEEDFORWARD 0 ///< 1: Acceleration command is fed forward to current reference through nominal inertia (Mn/Ktn), 0: Not used
+#define USE_VOLTAGE_FEEDFORWARD 0   ///< 1: Back-EMF (Ken*velocity) and resistive drop (Rn*current command) are fed forward to voltage reference, 0: Not used
+#define USE_DEADBEAT_CURRENT_CONTROL 0 ///< 1: Deadbeat current control on Rn/Ln model with compensation of one PWM period delay (floating-point controllers only), 0: PI current control
+#define USE_FREQUENCY_RESPONSE_ANALYZER 0 ///< 1: Frequency response analysis is started by serial commands (frequency_response.c, floating-point controllers only), 0: Not used
+#define USE_AUTO_TUNING         0   ///< 1: Sys push button (while SVON is on) starts relay feedback auto-tuning of all loops (relay_autotune.c, floating-point controllers with runtime gains only), 0: Not used
+#define USE_ENCODER_CALIBRATION 0   ///< 1: Serial command 'c' spins the motor and writes encoder correction table to flash (encoder_calibration.c, floating-point controllers only), 0: Not used
+#define DIVERGENCE_THRESHOLD_MS 300 ///< Threshold time to detect divergence (saturated without decrease of tracking error) [msec]
+#define DIVERGENCE_CHECK_INTERVAL_MS 20 ///< Interval to check decrease of tracking error while saturated [msec]
+/**************************************************/
+
+/*************** Velocity estimator ***************/
+#define VELOCITY_ESTIMATOR_PSEUDO_DIFF  0   ///< Pseudo-differential of position response (cutoff : Gpd)
+#define VELOCITY_ESTIMATOR_MT           1   ///< M/T method on timestamped encoder samples (window : Tmt)
+#define VELOCITY_ESTIMATOR_PLL          2   ///< Tracking loop (PLL) on timestamped encoder samples (bandwidth : Gpll)
+#define VELOCITY_ESTIMATOR_KALMAN       3   ///< Kalman filter fusing encoder, current response and model (gain : Lkf_*, position is predicted)
+
+#define VELOCITY_ESTIMATOR  VELOCITY_ESTIMATOR_PSEUDO_DIFF  ///< Velocity estimation method (fixed-point controllers always use pseudo-differential)
+/**************************************************/
+
+/********** Frequency response analyzer ***********/
+// Injection point (selected by serial command) :
+// - Voltage reference (minor loop)         : Output is current response (admittance of motor) [A/V]
+// - Current command (major loop)           : Output is velocity response (plant including current control) [rad/s/A]
+// - Acceleration reference (major loop)    : Output is negative controller output (open-loop transfer function of major loop)
+#define FRA_NUM_BINS            24      ///< Number of frequency bins
+#define FRA_SINE_CYCLES         4       ///< Measured cycles of each bin of swept sine
+#define FRA_PRBS_ORDER          10      ///< Order of PRBS (period : 1023 samples)
+#define FRA_PRBS_PERIODS        8       ///< Measured periods of PRBS
+#define FRA_MINOR_MIN_FREQUENCY 10.0f   ///< First bin of swept sine in minor loop [Hz]
+#define FRA_MINOR_MAX_FREQUENCY 5000.0f ///< Last bin of swept sine in minor loop [Hz]
+#define FRA_MAJOR_MIN_FREQUENCY 2.0f    ///< First bin of swept sine in major loop [Hz]
+#define FRA_MAJOR_MAX_FREQUENCY 1000.0f ///< Last bin of swept sine in major loop [Hz]
+#define FRA_VOLTAGE_AMPLITUDE   0.5f    ///< Amplitude of excitation at voltage reference [V]
+#define FRA_CURRENT_AMPLITUDE   0.05f   ///< Amplitude of excitation at current command [A]
+#define FRA_ACCELERATION_AMPLITUDE 100.0f ///< Amplitude of excitation at acceleration reference [rad/s^2]
+/**************************************************/
+
+/****************** Auto-tuning *******************/
+// Relay feedback experiments are executed loop by loop (current -> velocity -> position),
+// and each loop is controlled with the gains of the previous experiments.
+#define AUTOTUNE_RULE           TUNING_RULE_TYREUS_LUYBEN   ///< Tuning rule (TUNING_RULE_xxx of relay_autotune.h)
+#define AUTOTUNE_TIMEOUT        2.0f    ///< Timeout of each experiment [s]
+#define AUTOTUNE_CURRENT_RELAY  2.0f    ///< Relay amplitude of current loop experiment (voltage reference) [V]
+#define AUTOTUNE_CURRENT_HYSTERESIS 0.02f ///< Hysteresis of current loop experiment [A]
+#define AUTOTUNE_CURRENT_LIMIT  3.0f    ///< Current loop experiment fails if current exceeds this value [A]
+#define AUTOTUNE_VELOCITY_RELAY 1000.0f ///< Relay amplitude of velocity loop experiment (acceleration reference, larger than Fcn/Mn) [rad/s^2]
+#define AUTOTUNE_VELOCITY_HYSTERESIS 2.0f ///< Hysteresis of velocity loop experiment [rad/s]
+#define AUTOTUNE_VELOCITY_LIMIT 200.0f  ///< Velocity loop experiment fails if velocity exceeds this value [rad/s]
+#define AUTOTUNE_POSITION_RELAY 1000.0f ///< Relay amplitude of position loop experiment (acceleration reference) [rad/s^2]
+#define AUTOTUNE_POSITION_HYSTERESIS 0.005f ///< Hysteresis of position loop experiment [rad]
+#define AUTOTUNE_POSITION_LIMIT 6.3f    ///< Position loop experiment fails if position error exceeds this value [rad]
+/**************************************************/
+
+/************** Encoder calibration ***************/
+// The motor rotates under velocity control without correction, and the error of the encoder is fitted
+// as harmonics of its angle. The motor is stopped while the correction table is written to flash.
+#define ENCODER_CALIB_VELOCITY  20.0f   ///< Velocity command during calibration [rad/s]
+#define ENCODER_CALIB_REVOLUTIONS 4     ///< Revolutions of each measurement (slope, harmonics)
+#define ENCODER_CALIB_HARMONICS 8       ///< Number of fitted harmonics (up to ENCODER_CALIB_MAX_HARMONICS)
+#define ENCODER_CALIB_SETTLE_TIME 1.0f  ///< Time discarded until the velocity becomes steady [s]
+#define ENCODER_CALIB_TIMEOUT   10.0f   ///< Calibration fails if not finished within this time [s]
+/**************************************************/
+
+/************** Deadline miss policy **************/
+#define OVERRUN_POLICY_SKIP         0   ///< Skip the late cycle and wait for the next release
+#define OVERRUN_POLICY_RUN_LATE     1   ///< Execute the late cycle immediately (missed releases are dropped)
+#define OVERRUN_POLICY_SAFE_STOP    2   ///< Stop the motor in the same way as divergence detection
+
+#define MAJOR_LOOP_OVERRUN_POLICY   OVERRUN_POLICY_RUN_LATE ///< Policy when major loop misses its deadline
+#define MINOR_LOOP_OVERRUN_POLICY   OVERRUN_POLICY_RUN_LATE ///< Policy when minor loop misses its deadline
 /**************************************************/
 
 /********** Hardware-specific parameters **********/
@@ -33,12 +111,20 @@ extern "C" {
 #define Mn          0.0000005f      ///< Nominal Inertia [Nm/s^2*rad]
 #define Rn          0.6818f         ///< Nominal resistance (Mabuchi FA-130RA-2270) [Ohm]
 #define Ln          0.000340f       ///< Nominal inductance (Mabuchi FA-130RA-2270) [H]
+#define Ken         0.001159f       ///< Nominal back-EMF constant (equal to Ktn in SI units) [Vs/rad]
+#define Fcn         0.00010f        ///< Nominal Coulomb friction torque (identified from no-load current) [Nm]
+#define Dvn         0.00000007f     ///< Nominal viscous friction coefficient (identified from no-load current) [Nm*s/rad]
+#define FRICTION_VELOCITY_BAND 1.0f ///< Velocity where Coulomb friction model is saturated [rad/s]
 /**************************************************/
 
 /************ Default constol parameters *************/
 // Position control gains
 #define Kp_p_DEFAULT    4900.0f     ///< Proportional gain of position control [s^2]
+#if USE_DISTURBANCE_OBSERVER
+#define Ki_p_DEFAULT    0.0f        ///< Integral     gain of position control [s^3] (disturbance observer includes integral action)
+#else
 #define Ki_p_DEFAULT    6000.0f     ///< Integral     gain of position control [s^3]
+#endif
 #define Kd_p_DEFAULT    140.0f      ///< Differential gain of position control [s]
 
 // Velocity control gains
@@ -48,16 +134,39 @@ extern "C" {
 // Current control gains
 #define Kp_c_DEFAULT    0.5f        ///< Proportional gain of current control [V/A]
 #define Ki_c_DEFAULT    10.0f       ///< Integral     gain of current control [sV/A]
+#define Kdb_c_DEFAULT   1.0f        ///< Ratio of current error corrected in one period by deadbeat current control (1: deadbeat, smaller: less sensitive to noise)
 
 // Cutoff frequency
 #define Gpd_DEFAULT    1000.0f      ///< Cutoff frequency of pseudo-differential for velocity calculation [rad/sec]
+#define Gdob_DEFAULT   500.0f       ///< Cutoff frequency of disturbance observer [rad/sec]
+#define Gpll_DEFAULT   500.0f       ///< Bandwidth of tracking loop velocity estimator [rad/sec]
+#define Tmt_DEFAULT    0.001f       ///< Minimum measurement window of M/T velocity estimator [sec]
+
+// Steady-state Kalman gain (solved on the host for Mn, Ktn and dt_major above with
+// encoder quantization noise (2*pi/4096)^2/12 [rad^2], current noise 0.02 [A] and disturbance random walk 0.002 [A] per period)
+#define Lkf_p_DEFAULT  0.1444739f   ///< Kalman gain of position
+#define Lkf_v_DEFAULT  56.33022f    ///< Kalman gain of velocity [1/s]
+#define Lkf_d_DEFAULT  (-4.177508f) ///< Kalman gain of disturbance [A/rad]
+#define Grtob_DEFAULT  200.0f       ///< Cutoff frequency of reaction torque observer [rad/sec]
 /*****************************************************/
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported enum tag ---------------------------------------------------------*/
 /* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct DeadlineMissCount
+ * Number of missed deadlines of each control loop
+ */
+typedef struct
+{
+    uint32_t MajorLoop;     ///< Major loop
+    uint32_t MinorLoop;     ///< Minor loop
+} DeadlineMissCount;
+
 /* Exported variables --------------------------------------------------------*/
 /* Exported function prototypes ----------------------------------------------*/
+void MinorLoopISR(void);
+void getDeadlineMissCount(DeadlineMissCount*);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * @file    control_fixed.h
+ * @brief   Header file of fixed-point controller functions
+ * @details Controllers work directly on raw encoder counts, ADC counts and PWM compare values.
+ *          Gains are converted from physical units into Q7.24 format at configuration time,
+ *          so no floating-point calculation is executed in control loops.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONTROL_FIXED_H
+#define __CONTROL_FIXED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define FIXED_GAIN_Q    24      ///< Number of fractional bits of fixed-point gain (Q7.24)
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct FixedGains
+ * PID gains in Q7.24 format (output count per input count)
+ */
+typedef struct
+{
+    int32_t Kp;         ///< Proportional gain
+    int32_t KiTs;       ///< Integral gain multiplied by sampling time
+    int32_t Kd;         ///< Differential gain
+} FixedGains;
+
+/**
+ * @struct FixedPseudoDifferential
+ * Pseudo-differential filter for velocity calculation from position count
+ */
+typedef struct
+{
+    int64_t PosResInt;  ///< Integral of velocity response (filtered position) [count, Q16]
+    int32_t VelRes;     ///< Velocity response [count/s]
+    int32_t Gpd;        ///< Cutoff frequency [rad/s, Q8]
+    int32_t Ts;         ///< Sampling time [s, Q32]
+} FixedPseudoDifferential;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void setFixedGains(FixedGains*, float, float, float, float, float);
+int32_t toFixedGain(float);
+int32_t calcFixedPID(const FixedGains*, int32_t*, int32_t, int32_t);
+int32_t calcFixedPIDAntiWindup(const FixedGains*, int32_t*, int32_t, int32_t, int);
+void rebaseFixedPID(const FixedGains*, int32_t*, int32_t, int32_t, int32_t);
+int32_t calcFixedGain(int32_t, int32_t);
+int32_t saturateFixed(int32_t, int32_t);
+
+void initFixedPseudoDifferential(FixedPseudoDifferential*, float, float, int32_t);
+int32_t calcFixedPseudoDifferential(FixedPseudoDifferential*, int32_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTROL_FIXED_H */
+/***************************************************************END OF FILE****/
@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file    control_fixed_port.h
+ * @brief   Header file of target-dependent arithmetic for fixed-point controller functions
+ * @details control_fixed.c does not include any device header, so it builds for other cores and for the host.
+ *          Saturating addition uses QADD instruction on cores with DSP extension (Cortex-M4/M7),
+ *          and portable C on the others.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONTROL_FIXED_PORT_H
+#define __CONTROL_FIXED_PORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+/**
+ * @brief       Saturating addition of 32-bit values
+ * @param[in]   a Input
+ * @param[in]   b Input
+ * @return      a + b (saturated to int32_t)
+*/
+static inline int32_t addSatFixedPort(int32_t a, int32_t b)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    int32_t result;
+    __asm ("qadd %0, %1, %2" : "=r" (result) : "r" (a), "r" (b));
+    return result;
+#else
+    int64_t x = (int64_t) a + b;
+    if (x > INT32_MAX)
+        return INT32_MAX;
+    if (x < INT32_MIN)
+        return INT32_MIN;
+    return (int32_t) x;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTROL_FIXED_PORT_H */
+/***************************************************************END OF FILE****/
@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    control_kernel.h
+ * @brief   Header file of controller and filter kernels based on CMSIS-DSP
+ * @details PID controllers use arm_pid_f32 (incremental form) and filters use arm_biquad_cascade_df1_f32.
+ *          The library functions which are not inline in arm_math.h are provided by arm_math_compat.c
+ *          unless USE_CMSIS_DSP_LIBRARY is set to 1 (link libarm_cortexM4lf_math.a in that case).
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONTROL_KERNEL_H
+#define __CONTROL_KERNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "stm32f4xx.h"  // __FPU_PRESENT
+
+#ifndef ARM_MATH_CM4
+#define ARM_MATH_CM4
+#endif
+#include "arm_math.h"
+
+/* Exported macro ------------------------------------------------------------*/
+#ifndef USE_CMSIS_DSP_LIBRARY
+#define USE_CMSIS_DSP_LIBRARY   0   ///< 1: Link CMSIS-DSP library, 0: Use compatible implementation (arm_math_compat.c)
+#endif
+
+#define BIQUAD_MAX_STAGES       4   ///< Maximum number of 2nd order stages of one filter kernel
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct BiquadKernel
+ * Biquad cascade filter (Direct form I) with its own coefficient and state buffers
+ */
+typedef struct
+{
+    arm_biquad_casd_df1_inst_f32 Instance;
+    float32_t Coeffs[5 * BIQUAD_MAX_STAGES];    ///< {b0, b1, b2, a1, a2} of each stage (a1, a2 : sign of CMSIS-DSP)
+    float32_t State[4 * BIQUAD_MAX_STAGES];     ///< {x[n-1], x[n-2], y[n-1], y[n-2]} of each stage
+} BiquadKernel;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void setPIDKernel(arm_pid_instance_f32*, float, float, float, float, bool);
+float calcPIDKernelAntiWindup(arm_pid_instance_f32*, float, int);
+void rebasePIDKernel(arm_pid_instance_f32*, float, float);
+void initBiquadKernel(BiquadKernel*, uint8_t, const float*);
+void resetBiquadKernel(BiquadKernel*, float, float);
+float calcBiquadKernel(BiquadKernel*, float);
+void initPseudoDifferentialKernel(BiquadKernel*, float, float, float);
+
+void benchmarkControlKernels(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTROL_KERNEL_H */
+/***************************************************************END OF FILE****/
@@ -0,0 +1,424 @@
+/**
+ ******************************************************************************
+ * @file    controller.h
+ * @brief   Header-only library of discrete-time controllers (PI, PID, lead-lag, pseudo-differential, deadbeat)
+ * @details Each controller consists of coefficients and state.
+ *          - Coefficients are discretized by *_COEFFS macros. If all arguments are constants,
+ *            the products such as Ki*Ts are folded at compile time (e.g. static const coefficients for fixed-gain builds).
+ *          - set* functions calculate the same coefficients at runtime (runtime-tunable builds).
+ *          - calc* functions are common to both, so one controller instance can be declared per axis.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONTROLLER_H
+#define __CONTROLLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+/**
+ * @brief       Coefficients of PI controller : u = Kp*e + Ki*Integral(e)
+ * @param       Kp Proportional gain
+ * @param       Ki Integral gain
+ * @param       Ts Sampling time [s]
+ */
+#define PI_COEFFS(Kp, Ki, Ts)           { (Kp), (Ki) * (Ts) }
+
+/**
+ * @brief       Coefficients of PID controller : u = Kp*e + Ki*Integral(e) + Kd*de
+ * @param       Kp Proportional gain
+ * @param       Ki Integral gain
+ * @param       Kd Differential gain
+ * @param       Ts Sampling time [s]
+ */
+#define PID_COEFFS(Kp, Ki, Kd, Ts)      { (Kp), (Ki) * (Ts), (Kd) }
+
+/**
+ * @brief       Coefficients of lead-lag compensator : K*(1 + T1*s)/(1 + T2*s) (Tustin)
+ * @param       K Gain
+ * @param       T1 Time constant of numerator [s]
+ * @param       T2 Time constant of denominator [s]
+ * @param       Ts Sampling time [s]
+ */
+#define LEAD_LAG_COEFFS(K, T1, T2, Ts)                  \
+    {                                                   \
+        (K) * ((Ts) + 2.0f * (T1)) / ((Ts) + 2.0f * (T2)), \
+        (K) * ((Ts) - 2.0f * (T1)) / ((Ts) + 2.0f * (T2)), \
+        ((Ts) - 2.0f * (T2)) / ((Ts) + 2.0f * (T2))     \
+    }
+
+/**
+ * @brief       Coefficients of pseudo-differential : Gpd*s/(s + Gpd)
+ * @details     Same discretization as "Int += v*Ts; v = Gpd*(x - Int)" : v[n] = Gpd*(x[n] - x[n-1]) + (1 - Gpd*Ts)*v[n-1]
+ * @param       Gpd Cutoff frequency [rad/s]
+ * @param       Ts Sampling time [s]
+ */
+#define PSEUDO_DIFF_COEFFS(Gpd, Ts)     { (Gpd), 1.0f - (Gpd) * (Ts) }
+
+/**
+ * @brief       Coefficients of deadbeat controller for first-order plant 1/(L*s + R) with one sampling period of output delay
+ * @details     Plant is discretized as y[n+1] = A*y[n] + B*(u[n] - d), where the pole A = (2L - R*Ts)/(2L + R*Ts)
+ *              is the bilinear approximation of exp(-R*Ts/L) so that the coefficients can be folded at compile time.
+ * @param       R Resistance of plant (e.g. Rn [Ohm])
+ * @param       L Inductance of plant (e.g. Ln [H])
+ * @param       Ts Sampling time [s]
+ * @param       Gain Ratio of error corrected in one sampling period (1 : deadbeat, 0 < Gain <= 1)
+ * @param       Limit Output limit (e.g. supply voltage)
+ */
+#define DEADBEAT_COEFFS(R, L, Ts, Gain, Limit)                              \
+    {                                                                       \
+        (2.0f * (L) - (R) * (Ts)) / (2.0f * (L) + (R) * (Ts)),              \
+        2.0f * (Ts) / (2.0f * (L) + (R) * (Ts)),                            \
+        (2.0f * (L) + (R) * (Ts)) / (2.0f * (Ts)),                          \
+        (Gain), (Limit)                                                     \
+    }
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct PICoeffs
+ * Coefficients of PI controller
+ */
+typedef struct
+{
+    float Kp;       ///< Proportional gain
+    float KiTs;     ///< Integral gain multiplied by sampling time
+} PICoeffs;
+
+/**
+ * @struct PIDCoeffs
+ * Coefficients of PID controller
+ */
+typedef struct
+{
+    float Kp;       ///< Proportional gain
+    float KiTs;     ///< Integral gain multiplied by sampling time
+    float Kd;       ///< Differential gain
+} PIDCoeffs;
+
+/**
+ * @struct LeadLagCoeffs
+ * Coefficients of lead-lag compensator : y[n] = b0*x[n] + b1*x[n-1] - a1*y[n-1]
+ */
+typedef struct
+{
+    float b0, b1, a1;
+} LeadLagCoeffs;
+
+/**
+ * @struct PseudoDiffCoeffs
+ * Coefficients of pseudo-differential : v[n] = Gpd*(x[n] - x[n-1]) + A*v[n-1]
+ */
+typedef struct
+{
+    float Gpd;      ///< Cutoff frequency [rad/s]
+    float A;        ///< 1 - Gpd*Ts
+} PseudoDiffCoeffs;
+
+/**
+ * @struct DeadbeatCoeffs
+ * Coefficients of deadbeat controller : plant y[n+1] = A*y[n] + B*(u[n] - d)
+ */
+typedef struct
+{
+    float A;        ///< Pole of plant
+    float B;        ///< Input gain of plant
+    float InvB;     ///< 1/B
+    float Gain;     ///< Ratio of error corrected in one sampling period
+    float Limit;    ///< Output limit
+} DeadbeatCoeffs;
+
+/**
+ * @struct ControllerState
+ * State of PI/PID controller, lead-lag compensator, pseudo-differential and deadbeat controller
+ */
+typedef struct
+{
+    float Input;    ///< Previous input (lead-lag, pseudo-differential)
+    float Output;   ///< Integral term (PI, PID) or previous output (lead-lag, pseudo-differential, deadbeat)
+} ControllerState;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+/**
+ * @brief       Set coefficients of PI controller at runtime
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   Kp Proportional gain
+ * @param[in]   Ki Integral gain
+ * @param[in]   Ts Sampling time [s]
+*/
+static inline void setPICoeffs(PICoeffs* pCoeffs, float Kp, float Ki, float Ts)
+{
+    const PICoeffs Coeffs = PI_COEFFS(Kp, Ki, Ts);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Set coefficients of PID controller at runtime
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   Kp Proportional gain
+ * @param[in]   Ki Integral gain
+ * @param[in]   Kd Differential gain
+ * @param[in]   Ts Sampling time [s]
+*/
+static inline void setPIDCoeffs(PIDCoeffs* pCoeffs, float Kp, float Ki, float Kd, float Ts)
+{
+    const PIDCoeffs Coeffs = PID_COEFFS(Kp, Ki, Kd, Ts);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Set coefficients of lead-lag compensator at runtime
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   K Gain
+ * @param[in]   T1 Time constant of numerator [s]
+ * @param[in]   T2 Time constant of denominator [s]
+ * @param[in]   Ts Sampling time [s]
+*/
+static inline void setLeadLagCoeffs(LeadLagCoeffs* pCoeffs, float K, float T1, float T2, float Ts)
+{
+    const LeadLagCoeffs Coeffs = LEAD_LAG_COEFFS(K, T1, T2, Ts);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Set coefficients of pseudo-differential at runtime
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   Gpd Cutoff frequency [rad/s]
+ * @param[in]   Ts Sampling time [s]
+*/
+static inline void setPseudoDiffCoeffs(PseudoDiffCoeffs* pCoeffs, float Gpd, float Ts)
+{
+    const PseudoDiffCoeffs Coeffs = PSEUDO_DIFF_COEFFS(Gpd, Ts);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Set coefficients of deadbeat controller at runtime
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   R Resistance of plant
+ * @param[in]   L Inductance of plant
+ * @param[in]   Ts Sampling time [s]
+ * @param[in]   Gain Ratio of error corrected in one sampling period
+ * @param[in]   Limit Output limit
+*/
+static inline void setDeadbeatCoeffs(DeadbeatCoeffs* pCoeffs, float R, float L, float Ts, float Gain, float Limit)
+{
+    const DeadbeatCoeffs Coeffs = DEADBEAT_COEFFS(R, L, Ts, Gain, Limit);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Reset state of controller
+ * @param[out]  pState Pointer of state
+ * @param[in]   Input Previous input
+ * @param[in]   Output Integral term or previous output
+*/
+static inline void resetController(ControllerState* pState, float Input, float Output)
+{
+    pState->Input = Input;
+    pState->Output = Output;
+}
+
+/**
+ * @brief       PI controller
+ * @note        Integral term is accumulated after multiplying Ki*Ts, so gain change at runtime is bumpless.
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Err Error
+ * @return      Controller output
+*/
+static inline float calcPI(const PICoeffs* pCoeffs, ControllerState* pState, float Err)
+{
+    pState->Output += pCoeffs->KiTs * Err;
+    return pCoeffs->Kp * Err + pState->Output;
+}
+
+/**
+ * @brief       PID controller
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Err Error
+ * @param[in]   dErr Differential of error (e.g. velocity error for position control)
+ * @return      Controller output
+*/
+static inline float calcPID(const PIDCoeffs* pCoeffs, ControllerState* pState, float Err, float dErr)
+{
+    pState->Output += pCoeffs->KiTs * Err;
+    return pCoeffs->Kp * Err + pCoeffs->Kd * dErr + pState->Output;
+}
+
+/**
+ * @brief       Set integral term of PI controller so that the output for the present error is Output (bumpless transfer)
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Output Output to continue from (e.g. output of the controller used until now)
+ * @param[in]   Err Present error
+*/
+static inline void rebasePI(const PICoeffs* pCoeffs, ControllerState* pState, float Output, float Err)
+{
+    pState->Output = Output - pCoeffs->Kp * Err;
+}
+
+/**
+ * @brief       Set integral term of PID controller so that the output for the present error is Output (bumpless transfer)
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Output Output to continue from (e.g. output of the controller used until now)
+ * @param[in]   Err Present error
+ * @param[in]   dErr Present differential of error
+*/
+static inline void rebasePID(const PIDCoeffs* pCoeffs, ControllerState* pState, float Output, float Err, float dErr)
+{
+    pState->Output = Output - pCoeffs->Kp * Err - pCoeffs->Kd * dErr;
+}
+
+/**
+ * @brief       Saturation status of output
+ * @param[in]   Output Output before saturation
+ * @param[in]   Limit Positive limit
+ * @retval      1 : Saturated at upper limit
+ * @retval      -1 : Saturated at lower limit
+ * @retval      0 : Not saturated
+*/
+static inline int getSaturation(float Output, float Limit)
+{
+    if (Output >= Limit)
+        return 1;
+    if (Output <= -Limit)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief       Check if integration of error winds up the integral term (conditional integration)
+ * @param[in]   Saturation Saturation status of the output or of the inner loop driven by the output (see getSaturation)
+ * @param[in]   Err Error
+ * @retval      true : Error drives the output further into saturation, so integration should be stopped
+ * @retval      false : Integration is allowed (not saturated, or error brings the output back)
+*/
+static inline bool isWindingUp(int Saturation, float Err)
+{
+    return ((Saturation > 0) && (Err > 0.0f)) || ((Saturation < 0) && (Err < 0.0f));
+}
+
+/**
+ * @brief       PI controller with conditional integration anti-windup
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Err Error
+ * @param[in]   Saturation Saturation status of the previous output or of the inner loop (see getSaturation)
+ * @return      Controller output
+*/
+static inline float calcPIAntiWindup(const PICoeffs* pCoeffs, ControllerState* pState, float Err, int Saturation)
+{
+    if (!isWindingUp(Saturation, Err))
+        pState->Output += pCoeffs->KiTs * Err;
+    return pCoeffs->Kp * Err + pState->Output;
+}
+
+/**
+ * @brief       PID controller with conditional integration anti-windup
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Err Error
+ * @param[in]   dErr Differential of error (e.g. velocity error for position control)
+ * @param[in]   Saturation Saturation status of the previous output or of the inner loop (see getSaturation)
+ * @return      Controller output
+*/
+static inline float calcPIDAntiWindup(const PIDCoeffs* pCoeffs, ControllerState* pState, float Err, float dErr, int Saturation)
+{
+    if (!isWindingUp(Saturation, Err))
+        pState->Output += pCoeffs->KiTs * Err;
+    return pCoeffs->Kp * Err + pCoeffs->Kd * dErr + pState->Output;
+}
+
+/**
+ * @brief       Lead-lag compensator
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Input Input
+ * @return      Output
+*/
+static inline float calcLeadLag(const LeadLagCoeffs* pCoeffs, ControllerState* pState, float Input)
+{
+    float Output = pCoeffs->b0 * Input + pCoeffs->b1 * pState->Input - pCoeffs->a1 * pState->Output;
+    pState->Input = Input;
+    pState->Output = Output;
+    return Output;
+}
+
+/**
+ * @brief       Pseudo-differential
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Input Input (e.g. position response)
+ * @return      Output (e.g. velocity response)
+*/
+static inline float calcPseudoDiff(const PseudoDiffCoeffs* pCoeffs, ControllerState* pState, float Input)
+{
+    float Output = pCoeffs->Gpd * (Input - pState->Input) + pCoeffs->A * pState->Output;
+    pState->Input = Input;
+    pState->Output = Output;
+    return Output;
+}
+
+/**
+ * @brief       Deadbeat (predictive) controller with one sampling period of output delay compensation
+ * @details     The output of the previous step is applied during the present period,
+ *              so the response at the next sampling instant is predicted first,
+ *              and the output which brings the response to the command one period later is calculated.
+ *              With Gain = 1, the response reaches a step command in two periods.
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state (Output : output applied in the present period)
+ * @param[in]   Cmd Command (e.g. current command)
+ * @param[in]   Res Response sampled at the beginning of the present period (e.g. current response)
+ * @param[in]   Dist Known disturbance of plant input (e.g. back-EMF voltage)
+ * @return      Output (saturated by Limit)
+*/
+static inline float calcDeadbeat(const DeadbeatCoeffs* pCoeffs, ControllerState* pState, float Cmd, float Res, float Dist)
+{
+    float Pred = pCoeffs->A * Res + pCoeffs->B * (pState->Output - Dist);
+    float Target = Pred + pCoeffs->Gain * (Cmd - Pred);
+    float Output = pCoeffs->InvB * (Target - pCoeffs->A * Pred) + Dist;
+
+    if (Output > pCoeffs->Limit)
+        Output = pCoeffs->Limit;
+    else if (Output < -pCoeffs->Limit)
+        Output = -pCoeffs->Limit;
+    pState->Output = Output;
+    return Output;
+}
+
+/**
+ * @brief       Change input of pseudo-differential without changing output (e.g. when position response is redefined)
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Input New present input
+*/
+static inline void rebasePseudoDiff(const PseudoDiffCoeffs* pCoeffs, ControllerState* pState, float Input)
+{
+    // Same as setting "Int = Input" of "Int += v*Ts; v = Gpd*(x - Int)"
+    pState->Input = Input + pState->Output / pCoeffs->Gpd;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTROLLER_H */
+/***************************************************************END OF FILE****/
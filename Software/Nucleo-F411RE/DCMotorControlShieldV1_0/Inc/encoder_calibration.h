@@ -0,0 +1,107 @@
+/**
+ ******************************************************************************
+ * @file    encoder_calibration.h
+ * @brief   Header file of encoder nonlinearity calibration (Fourier fit of position-periodic error)
+ * @details While the motor rotates at constant velocity, the position increases linearly with time,
+ *          so the residual from the line is the error of the encoder as a function of its single-turn angle.
+ *          - Settling : samples are discarded until the velocity becomes steady
+ *          - Slope : slope of the line is measured over the given number of revolutions
+ *          - Fourier : residual is correlated with the first harmonics of the angle over the same number of revolutions
+ *          The fitted error is stored as a correction table indexed by the angle (one load and add per sample).
+ *          Velocity ripple caused by the load (e.g. cogging) is also periodic in position and is fitted as well,
+ *          so the calibration should be executed with low-bandwidth velocity control.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ENCODER_CALIBRATION_H
+#define __ENCODER_CALIBRATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define ENCODER_CALIB_MAX_HARMONICS 16  ///< Maximum number of fitted harmonics
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum EncoderCalibStatus
+ * Status of encoder calibration
+ */
+typedef enum
+{
+    Idle_EncoderCalibStatus = 0,    ///< Not started (or stopped)
+    Settling_EncoderCalibStatus,    ///< Waiting for steady velocity
+    Slope_EncoderCalibStatus,       ///< Measuring slope of position
+    Fourier_EncoderCalibStatus,     ///< Measuring harmonics of residual
+    Finished_EncoderCalibStatus,    ///< Harmonics are available
+    Failed_EncoderCalibStatus       ///< Timeout (motor did not rotate)
+} EncoderCalibStatus;
+
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct EncoderCalibration
+ * Encoder calibration
+ */
+typedef struct
+{
+    uint32_t CountsPerRev;          ///< Encoder counts per revolution (size of correction table)
+    uint32_t Harmonics;             ///< Number of fitted harmonics
+    uint32_t Revolutions;           ///< Revolutions of each measurement
+    uint32_t SettleSamples;         ///< Samples discarded before measurement
+    uint32_t Timeout;               ///< Calibration fails if not finished within this time [sample]
+    float TimestampFrequency;       ///< Frequency of timestamp [Hz]
+    volatile EncoderCalibStatus Status;
+
+    uint32_t SampleCount;           ///< Samples since start
+    uint32_t StartCount;            ///< Position at the start of the present measurement [count]
+    uint32_t StartTimestamp;        ///< Timestamp at the start of the present measurement
+    float Slope;                    ///< Slope of position [count/s]
+    uint32_t NumSamples;            ///< Samples of Fourier measurement
+    float ResidualSum;              ///< Sum of residual
+    float ResidualCosSum[ENCODER_CALIB_MAX_HARMONICS], ResidualSinSum[ENCODER_CALIB_MAX_HARMONICS];
+    float CosSum[ENCODER_CALIB_MAX_HARMONICS], SinSum[ENCODER_CALIB_MAX_HARMONICS];
+
+    float CosCoeff[ENCODER_CALIB_MAX_HARMONICS];    ///< Error = sum(CosCoeff[h-1]*cos(h*angle) + SinCoeff[h-1]*sin(h*angle)) [count]
+    float SinCoeff[ENCODER_CALIB_MAX_HARMONICS];
+} EncoderCalibration;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+int startEncoderCalibration(EncoderCalibration*, uint32_t, uint32_t, uint32_t, float, float, float, float);
+void stopEncoderCalibration(EncoderCalibration*);
+void updateEncoderCalibration(EncoderCalibration*, uint32_t, uint16_t, uint32_t);
+int generateEncoderCorrectionTable(const EncoderCalibration*, int8_t*);
+float getEncoderCalibrationAmplitude(const EncoderCalibration*, uint32_t);
+
+/**
+ * @brief       Check if calibration is in progress
+ * @param[in]   pCalib Pointer of calibration
+ * @retval      true : Settling or measuring
+ * @retval      false : Idle, finished or failed
+*/
+static inline bool isEncoderCalibrationRunning(const EncoderCalibration* pCalib)
+{
+    return (pCalib->Status == Settling_EncoderCalibStatus) || (pCalib->Status == Slope_EncoderCalibStatus)
+            || (pCalib->Status == Fourier_EncoderCalibStatus);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ENCODER_CALIBRATION_H */
+/***************************************************************END OF FILE****/
@@ -0,0 +1,135 @@
+/**
+ ******************************************************************************
+ * @file    frequency_response.h
+ * @brief   Header file of on-device frequency response analyzer (swept sine and PRBS excitation)
+ * @details The analyzer adds excitation to a signal of a control loop and correlates the signal after the injection (Input)
+ *          and a response (Output) sample by sample, so only the resulting table of Output/Input is sent to the PC.
+ *          - Swept sine : frequency is stepped bin by bin. Each bin is settled for FRA_SETTLE_CYCLES cycles,
+ *            then Input and Output are correlated with the excitation phasor over the given number of cycles (DFT of one bin).
+ *          - PRBS : maximum length sequence excites all bins at once. After one period for settling,
+ *            Input and Output are summed sample by sample over the given number of periods (synchronous averaging),
+ *            so the sampling period costs two additions regardless of the number of bins.
+ *            Each bin is calculated from the summed period by Goertzel algorithm when the result is read
+ *            (spectrum of the sum is equal to the sum of the spectra of each period).
+ *          Bin frequencies are snapped so that the measurement window has an integer number of cycles (no leakage).
+ *          Usage (once per sampling period) : Signal += calcFRAExcitation(); then updateFRA(Signal, Response);
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FREQUENCY_RESPONSE_H
+#define __FREQUENCY_RESPONSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define FRA_MAX_BINS        32  ///< Maximum number of frequency bins
+#define FRA_SETTLE_CYCLES   2   ///< Cycles of swept sine discarded before measurement of each bin
+#define FRA_PRBS_MIN_ORDER  5   ///< Minimum order of PRBS (period : 2^Order - 1 bits)
+#define FRA_PRBS_MAX_ORDER  16  ///< Maximum order of PRBS
+#define FRA_PRBS_MAX_LENGTH 1023    ///< Maximum samples per period of PRBS (order * hold is limited by buffer of synchronous averaging)
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum FRAExcitation
+ * Type of excitation
+ */
+typedef enum
+{
+    SweptSine_Excitation = 0,   ///< Stepped sine wave
+    PRBS_Excitation             ///< Pseudo-random binary sequence
+} FRAExcitation;
+
+/**
+ * @enum FRAStatus
+ * Status of analyzer
+ */
+typedef enum
+{
+    Idle_FRAStatus = 0,         ///< Not started (or stopped)
+    Settling_FRAStatus,         ///< Excitation is applied, response is not measured
+    Measuring_FRAStatus,        ///< Excitation is applied, response is measured
+    Finished_FRAStatus          ///< Result is available
+} FRAStatus;
+
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct FRABin
+ * Frequency bin
+ */
+typedef struct
+{
+    float Frequency;            ///< Frequency [Hz]
+    float Cos, Sin;             ///< cos(w), sin(w) (w : [rad/sample])
+    uint32_t Period;            ///< Samples per cycle (swept sine)
+    float InputRe, InputIm;     ///< Accumulated spectrum of Input (swept sine)
+    float OutputRe, OutputIm;   ///< Accumulated spectrum of Output (swept sine)
+} FRABin;
+
+/**
+ * @struct FRA
+ * Frequency response analyzer
+ */
+typedef struct
+{
+    FRAExcitation Excitation;
+    float Amplitude;            ///< Amplitude of excitation
+    float Ts;                   ///< Sampling time [s]
+    uint32_t NumBins;
+    FRABin Bins[FRA_MAX_BINS];
+    volatile FRAStatus Status;
+
+    uint32_t BinIndex;          ///< Present bin (swept sine)
+    uint32_t SampleCount;       ///< Samples in present cycle (swept sine) or period (PRBS)
+    uint32_t CycleCount;        ///< Cycles (swept sine) or periods (PRBS) in present status
+    uint32_t MeasureCycles;     ///< Cycles (swept sine) or periods (PRBS) to be measured
+    float PhasorCos, PhasorSin; ///< Excitation phasor (swept sine)
+
+    uint32_t PRBSLength;        ///< Samples per period (PRBS)
+    uint32_t PRBSHold;          ///< Samples per bit (PRBS)
+    uint32_t LFSR, LFSRMask;    ///< Galois LFSR (PRBS)
+    float PRBSInput[FRA_PRBS_MAX_LENGTH];   ///< Input summed over measured periods at each sample of the period (PRBS)
+    float PRBSOutput[FRA_PRBS_MAX_LENGTH];  ///< Output summed over measured periods at each sample of the period (PRBS)
+} FRA;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+int initSweptSineFRA(FRA*, float, float, float, uint32_t, uint32_t, float);
+int initPRBSFRA(FRA*, float, uint32_t, uint32_t, uint32_t, uint32_t, float);
+void startFRA(FRA*);
+void stopFRA(FRA*);
+float calcFRAExcitation(const FRA*);
+void updateFRA(FRA*, float, float);
+int getFRAResult(const FRA*, uint32_t, float*, float*, float*);
+
+/**
+ * @brief       Check if excitation is applied
+ * @param[in]   pFRA Pointer of analyzer
+ * @retval      true : Settling or measuring
+ * @retval      false : Idle or finished
+*/
+static inline bool isFRARunning(const FRA* pFRA)
+{
+    return (pFRA->Status == Settling_FRAStatus) || (pFRA->Status == Measuring_FRAStatus);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FREQUENCY_RESPONSE_H */
+/***************************************************************END OF FILE****/
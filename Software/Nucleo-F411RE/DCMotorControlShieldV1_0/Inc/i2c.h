@@ -58,7 +58,7 @@
 #include "main.h"
 
 /* USER CODE BEGIN Includes */
-
+#include <stdbool.h>
 /* USER CODE END Includes */
 
 extern I2C_HandleTypeDef hi2c1;
@@ -72,9 +72,12 @@ extern void _Error_Handler(char *, int);
 void MX_I2C1_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-void I2C1_MemRxCpltCallback(I2C_HandleTypeDef *);
+bool I2C1_EV_UserIRQHandler(void);
+bool I2C1_ER_UserIRQHandler(void);
+bool I2C1_RxDMA_UserIRQHandler(void);
 void I2C1_ErrorCallback(I2C_HandleTypeDef *);
 void I2C1_SoftReset(void);
+bool I2C1_RecoverBusStep(uint32_t*);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
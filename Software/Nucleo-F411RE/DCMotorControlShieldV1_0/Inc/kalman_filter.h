@@ -0,0 +1,88 @@
+/**
+ ******************************************************************************
+ * @file    kalman_filter.h
+ * @brief   Header file of steady-state Kalman filter for position, velocity and disturbance
+ * @details Model (Ts : sampling time, b = Kt/M, I : current response, d : current which cancels disturbance) :
+ *          - Position[k+1]    = Position[k] + Ts*Velocity[k] + Ts^2/2*b*(I[k] - d[k])
+ *          - Velocity[k+1]    = Velocity[k] + Ts*b*(I[k] - d[k])
+ *          - Disturbance[k+1] = Disturbance[k]
+ *          Encoder position is measured one sampling period before it is used (I2C read is started in the previous period),
+ *          so the filter corrects the state of the previous period and predicts the present state.
+ *          The Kalman gain is constant (solution of Riccati equation calculated on the host), so one step costs about ten multiply-adds.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KALMAN_FILTER_H
+#define __KALMAN_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+/**
+ * @brief       Coefficients of Kalman filter
+ * @param       M Nominal inertia [Nm/s^2*rad]
+ * @param       Kt Nominal torque constant [Nm/A]
+ * @param       Ts Sampling time [s]
+ * @param       Lp Kalman gain of position
+ * @param       Lv Kalman gain of velocity [1/s]
+ * @param       Ld Kalman gain of disturbance [A/rad]
+ */
+#define KALMAN_COEFFS(M, Kt, Ts, Lp, Lv, Ld)                \
+    {                                                       \
+        (Ts), 0.5f * (Ts) * (Ts) * (Kt) / (M), (Ts) * (Kt) / (M), \
+        (Lp), (Lv), (Ld)                                    \
+    }
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct KalmanCoeffs
+ * Coefficients of Kalman filter
+ */
+typedef struct
+{
+    float Ts;           ///< Velocity to position
+    float Ts2b;         ///< Current to position : Ts^2/2*Kt/M
+    float Tsb;          ///< Current to velocity : Ts*Kt/M
+    float Lp, Lv, Ld;   ///< Steady-state Kalman gain
+} KalmanCoeffs;
+
+/**
+ * @struct KalmanFilter
+ * State of Kalman filter (predicted state of present sampling period)
+ */
+typedef struct
+{
+    float Position;     ///< [rad]
+    float Velocity;     ///< [rad/s]
+    float Disturbance;  ///< Current which cancels disturbance [A]
+    uint32_t PrevTimestamp;
+    bool isInitialized;
+} KalmanFilter;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void resetKalmanFilter(KalmanFilter*);
+void calcKalmanFilter(const KalmanCoeffs*, KalmanFilter*, float, uint32_t, float);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KALMAN_FILTER_H */
+/***************************************************************END OF FILE****/
@@ -101,7 +101,20 @@ extern "C" {
 #define I2C_SDA_GPIO_Port GPIOB
 
 /* USER CODE BEGIN Private defines */
+#define USE_ISR_MINOR_LOOP      1       // 1: Minor loop is executed in ADC1 conversion complete interrupt (synchronized with TIM3 PWM)
+                                        // 0: Minor loop is executed in MinorLoopTask by FreeRTOS tick
+#if USE_ISR_MINOR_LOOP
+#define FreeRTOS_PERIOD_HZ      1000
+#else
 #define FreeRTOS_PERIOD_HZ      20000
+#endif
+
+#define USE_ENCODER_ANALOG_OUTPUT 0     // 1: Position is sampled from AS5600 OUT pin by ADC1 (PC0 = Arduino A5), I2C is the fallback
+                                        // 0: Position is read by I2C
+                                        // Arduino A5 is not connected on the base PCB, so a jumper wire from CN_AS5600 pin 6 (OUT)
+                                        // to Arduino A5 is required (without it, ADC1 samples a floating pin)
+#define EncOut_Pin GPIO_PIN_0
+#define EncOut_GPIO_Port GPIOC
 
 #ifdef TIM_CLOCK_SOURCE_HZ
 #undef TIM_CLOCK_SOURCE_HZ
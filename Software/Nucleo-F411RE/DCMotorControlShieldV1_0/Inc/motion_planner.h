@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * @file    motion_planner.h
+ * @brief   Header file of point-to-point motion planner
+ * @details Moves are planned as trapezoidal (jerk = 0) or S-curve (jerk > 0) velocity profiles when they are enqueued.
+ *          Each profile is stored as phases of constant jerk, so the major loop only evaluates a cubic polynomial per tick.
+ *          - Producer context (e.g. low priority task) : enqueueMove, enqueueDwell
+ *          - Consumer context (major loop) : calcMotion, resetMotion
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MOTION_PLANNER_H
+#define __MOTION_PLANNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define MOTION_QUEUE_SIZE   8   ///< Number of segments in queue (power of 2)
+#define MOTION_MAX_PHASES   7   ///< Maximum number of constant jerk phases of one segment
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct MotionPhase
+ * Constant jerk phase
+ */
+typedef struct
+{
+    float StartTime;        ///< Start time from the beginning of segment [s]
+    float Position;         ///< Position at StartTime
+    float Velocity;         ///< Velocity at StartTime
+    float Acceleration;     ///< Acceleration at StartTime
+    float Jerk;             ///< Jerk in this phase
+} MotionPhase;
+
+/**
+ * @struct MotionSegment
+ * Planned move or dwell
+ */
+typedef struct
+{
+    uint32_t NumPhases;
+    float Duration;         ///< Duration of segment [s]
+    float Target;           ///< Position at the end of segment
+    uint32_t ResetCount;    ///< ResetCount of planner when this segment was planned (stale segments are discarded)
+    MotionPhase Phases[MOTION_MAX_PHASES];
+} MotionSegment;
+
+/**
+ * @struct MotionReference
+ * Output of motion planner
+ */
+typedef struct
+{
+    float Position;
+    float Velocity;
+    float Acceleration;
+} MotionReference;
+
+/**
+ * @struct MotionPlanner
+ * Segment queue (single producer, single consumer) and evaluation state
+ */
+typedef struct
+{
+    MotionSegment Queue[MOTION_QUEUE_SIZE];
+    volatile uint32_t Head;             ///< Written by producer
+    volatile uint32_t Tail;             ///< Written by consumer
+    float Ts;                           ///< Sampling time of consumer [s]
+
+    // Producer
+    float PlanPosition;                 ///< Target of last enqueued segment
+    uint32_t ResetCountSeen;
+
+    // Consumer
+    volatile uint32_t ResetCount;       ///< Incremented by resetMotion
+    volatile float ResetPosition;       ///< Hold position given by resetMotion
+    float HoldPosition;                 ///< Position while queue is empty
+    uint32_t Tick;                      ///< Elapsed ticks in present segment
+    uint32_t PhaseIndex;                ///< Present phase
+} MotionPlanner;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void initMotionPlanner(MotionPlanner*, float, float);
+int enqueueMove(MotionPlanner*, float, float, float, float);
+int enqueueDwell(MotionPlanner*, float);
+uint32_t getMotionQueueSpace(const MotionPlanner*);
+bool calcMotion(MotionPlanner*, uint32_t, MotionReference*);
+void resetMotion(MotionPlanner*, float);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MOTION_PLANNER_H */
+/***************************************************************END OF FILE****/
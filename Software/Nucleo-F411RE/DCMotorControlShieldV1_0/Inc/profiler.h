@@ -0,0 +1,81 @@
+/**
+ ******************************************************************************
+ * @file    profiler.h
+ * @brief   Header file of loop profiler using DWT cycle counter
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#ifndef USE_LOOP_PROFILER
+#define USE_LOOP_PROFILER   1   ///< 1: Enable loop profiler, 0: Disable (all profiler macros are compiled to nothing)
+#endif
+
+#define PROFILER_HIST_BINS  16  ///< Number of log2 histogram bins (bin n : 2^(n-1) <= cycles < 2^n)
+
+#if USE_LOOP_PROFILER
+#define PROFILER_INIT()         initProfiler()
+#define PROFILER_BEGIN(id)      beginProfile(id)
+#define PROFILER_END(id)        endProfile(id)
+#define PROFILER_SKIP(id)       skipProfile(id)
+#define PROFILER_OUTPUT()       outputProfile()
+#define PROFILER_RESET()        resetProfile()
+#else
+#define PROFILER_INIT()         ((void)0)
+#define PROFILER_BEGIN(id)      ((void)0)
+#define PROFILER_END(id)        ((void)0)
+#define PROFILER_SKIP(id)       ((void)0)
+#define PROFILER_OUTPUT()       ((void)0)
+#define PROFILER_RESET()        ((void)0)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum ProfileId
+ * Profiled loops and ISRs
+ */
+typedef enum
+{
+    MajorControlLoop_Profile = 0,   ///< MajorControlLoop (Period : 200[us])
+    MinorControlLoop_Profile,       ///< MinorControlLoop (Period : 50[us])
+    ReadPositionResponse_Profile,   ///< readPositionResponse (Period : 200[us])
+    ADC1_ConvCpltCallback_Profile,  ///< ADC1_ConvCpltCallback (Period : 50[us])
+    Num_Profile
+} ProfileId;
+
+/* Exported struct/union tag -------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+#if USE_LOOP_PROFILER
+void initProfiler(void);
+void beginProfile(ProfileId);
+void endProfile(ProfileId);
+void skipProfile(ProfileId);
+void outputProfile(void);
+void resetProfile(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILER_H */
+/***************************************************************END OF FILE****/
@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+ * @file    relay_autotune.h
+ * @brief   Header file of relay feedback experiment for auto-tuning
+ * @details The relay replaces the controller of a loop and outputs +Amplitude or -Amplitude by the sign of the error
+ *          (with hysteresis), so the loop oscillates at the frequency where the phase of the plant is -180[deg].
+ *          From the amplitude a of the error and the period Tu of the oscillation,
+ *          the ultimate gain is Ku = 4*Amplitude/(pi*sqrt(a^2 - Hysteresis^2)) (describing function of the relay),
+ *          and PI gains are calculated by a tuning rule.
+ *          The first RELAY_SETTLE_CYCLES cycles are discarded and the next RELAY_MEASURE_CYCLES cycles are averaged.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RELAY_AUTOTUNE_H
+#define __RELAY_AUTOTUNE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define RELAY_SETTLE_CYCLES     2   ///< Cycles discarded until the oscillation becomes steady
+#define RELAY_MEASURE_CYCLES    4   ///< Cycles averaged
+
+#define TUNING_RULE_ZIEGLER_NICHOLS 0   ///< PI : Kp = 0.45*Ku, Ti = Tu/1.2 (fast, about 10[dB] less gain margin)
+#define TUNING_RULE_TYREUS_LUYBEN   1   ///< PI : Kp = Ku/3.2, Ti = 2.2*Tu (robust, less overshoot)
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum RelayStatus
+ * Status of relay feedback experiment
+ */
+typedef enum
+{
+    Idle_RelayStatus = 0,       ///< Not started (or stopped)
+    Running_RelayStatus,        ///< Relay is applied
+    Finished_RelayStatus,       ///< Ultimate gain and period are available
+    Failed_RelayStatus          ///< Timeout, error limit exceeded or no oscillation
+} RelayStatus;
+
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct RelayExperiment
+ * Relay feedback experiment
+ */
+typedef struct
+{
+    float Amplitude;            ///< Output amplitude of relay
+    float Hysteresis;           ///< Hysteresis of relay (error band where the output is kept)
+    float ErrorLimit;           ///< Experiment fails if |error| exceeds this value
+    float Ts;                   ///< Sampling time [s]
+    uint32_t Timeout;           ///< Experiment fails if not finished within this time [sample]
+    volatile RelayStatus Status;
+
+    float Output;               ///< Present output of relay
+    uint32_t SampleCount;       ///< Samples since start
+    uint32_t LastRiseCount;     ///< Sample when the output was switched to +Amplitude
+    uint32_t Cycles;            ///< Completed cycles
+    float MaxErr, MinErr;       ///< Peaks of error in the present cycle
+    uint32_t PeriodSum;         ///< Sum of measured periods [sample]
+    float AmplitudeSum;         ///< Sum of measured amplitudes of error
+
+    float UltimateGain;         ///< Ku
+    float UltimatePeriod;       ///< Tu [s]
+} RelayExperiment;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void startRelayExperiment(RelayExperiment*, float, float, float, float, float);
+void stopRelayExperiment(RelayExperiment*);
+float calcRelayExperiment(RelayExperiment*, float);
+int calcRelayTuningGains(const RelayExperiment*, int, float*, float*);
+
+/**
+ * @brief       Check if relay is applied
+ * @param[in]   pRelay Pointer of experiment
+ * @retval      true : Running
+ * @retval      false : Idle, finished or failed
+*/
+static inline bool isRelayExperimentRunning(const RelayExperiment* pRelay)
+{
+    return pRelay->Status == Running_RelayStatus;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RELAY_AUTOTUNE_H */
+/***************************************************************END OF FILE****/
@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * @file    snapshot.h
+ * @brief   Header file of lock-free snapshot (sequence counter and double buffer)
+ * @details A snapshot passes a set of values from one writer context to any number of reader contexts
+ *          without disabling interrupts.
+ *          - The writer stores new values into the buffer which is not published, then increments the sequence counter.
+ *            So the writer never waits.
+ *          - A reader copies the published buffer and retries if the sequence counter has changed during the copy.
+ *            A reader which preempts the writer always reads a complete buffer, so it does not retry.
+ *          Each snapshot must have only one writer context.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "stm32f4xx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+/**
+ * @brief       Snapshot type of the given value type
+ * @param       type Value type
+ */
+#define SNAPSHOT(type)  struct { volatile uint32_t Sequence; type Buffer[2]; }
+
+/**
+ * @brief       Publish a new value (writer context only)
+ * @param[in,out] pSnapshot Pointer of snapshot
+ * @param[in]   value New value
+ */
+#define writeSnapshot(pSnapshot, value)                         \
+    do {                                                        \
+        uint32_t seq_ = (pSnapshot)->Sequence + 1;              \
+        (pSnapshot)->Buffer[seq_ & 1] = (value);                \
+        __DMB();                                                \
+        (pSnapshot)->Sequence = seq_;                           \
+    } while (0)
+
+/**
+ * @brief       Read a consistent copy of the published value
+ * @param[in]   pSnapshot Pointer of snapshot
+ * @param[out]  pValue Pointer to store the value
+ */
+#define readSnapshot(pSnapshot, pValue)                         \
+    do {                                                        \
+        uint32_t seq_;                                          \
+        do {                                                    \
+            seq_ = (pSnapshot)->Sequence;                       \
+            __DMB();                                            \
+            *(pValue) = (pSnapshot)->Buffer[seq_ & 1];          \
+            __DMB();                                            \
+        } while (seq_ != (pSnapshot)->Sequence);                \
+    } while (0)
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SNAPSHOT_H */
+/***************************************************************END OF FILE****/
@@ -50,6 +50,7 @@ void DMA1_Stream0_IRQHandler(void);
 void ADC_IRQHandler(void);
 void I2C1_EV_IRQHandler(void);
 void I2C1_ER_IRQHandler(void);
+void TIM4_IRQHandler(void);
 void DMA2_Stream0_IRQHandler(void);
 
 #ifdef __cplusplus
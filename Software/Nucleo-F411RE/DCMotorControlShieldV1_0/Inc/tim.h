@@ -62,19 +62,27 @@
 /* USER CODE END Includes */
 
 extern TIM_HandleTypeDef htim3;
+extern TIM_HandleTypeDef htim4;
 
 /* USER CODE BEGIN Private defines */
-
+// TIM3 update flag is used to detect that PWM period has elapsed (TIM3 update interrupt is not used)
+#define clearPWMPeriodElapsedFlag() __HAL_TIM_CLEAR_FLAG(&htim3, TIM_FLAG_UPDATE)
+#define isPWMPeriodElapsed()        (__HAL_TIM_GET_FLAG(&htim3, TIM_FLAG_UPDATE) != RESET)
+// TIM3 is clocked by SystemCoreClock (TIM_CLOCK_SOURCE_HZ), so the start of the present PWM period is given in DWT cycles
+#define getPWMPeriodStartCycle()    (DWT->CYCCNT - __HAL_TIM_GET_COUNTER(&htim3))
+#define getPWMPeriodCycles()        (__HAL_TIM_GET_AUTORELOAD(&htim3) + 1)
 /* USER CODE END Private defines */
 
 extern void _Error_Handler(char *, int);
 
 void MX_TIM3_Init(void);
+void MX_TIM4_Init(void);
                     
 void HAL_TIM_MspPostInit(TIM_HandleTypeDef *htim);
                 
 
 /* USER CODE BEGIN Prototypes */
+void TIM4_PeriodElapsedCallback(TIM_HandleTypeDef *);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
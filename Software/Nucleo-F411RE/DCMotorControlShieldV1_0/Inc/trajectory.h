@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * @file    trajectory.h
+ * @brief   Header file of periodic trajectory source
+ * @details A trajectory source repeats a sequence of segments (hold or sine).
+ *          Time is kept as integer ticks and sine segments use a rotating phasor,
+ *          so the command does not lose precision with uptime and needs no sinf/cosf/fmodf in each tick.
+ *          The count source converts the same segments into encoder counts at initialization
+ *          and calculates the command with integer arithmetic only (fixed-point control).
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRAJECTORY_H
+#define __TRAJECTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define TRAJECTORY_RESYNC_TICKS 1024    ///< Interval to recalculate the phasor of sine segment from phase accumulator [tick]
+#define TRAJECTORY_MAX_SEGMENTS 8       ///< Maximum number of segments of count source
+
+/**
+ * @brief       Convert time into ticks
+ * @param       Time Time [s]
+ * @param       Ts Sampling time [s]
+ */
+#define SEC_TO_TICKS(Time, Ts)  ((uint32_t) ((Time) / (Ts) + 0.5f))
+
+/**
+ * @brief       Hold segment
+ * @param       Duration Duration [tick]
+ * @param       Position Position command
+ */
+#define TRAJECTORY_HOLD(Duration, Position)     { Hold_Segment, (Duration), (Position), 0.0f, 0.0f }
+
+/**
+ * @brief       Sine segment : Position + Amplitude*sin(2*pi*Frequency*t) (t starts from 0 in each segment)
+ * @param       Duration Duration [tick]
+ * @param       Position Center position
+ * @param       Amplitude Amplitude
+ * @param       Frequency Frequency [Hz]
+ */
+#define TRAJECTORY_SINE(Duration, Position, Amplitude, Frequency) \
+    { Sine_Segment, (Duration), (Position), (Amplitude), (Frequency) }
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/**
+ * @enum SegmentType
+ * Type of trajectory segment
+ */
+typedef enum
+{
+    Hold_Segment = 0,   ///< Constant position
+    Sine_Segment        ///< Sine wave
+} SegmentType;
+
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct TrajectorySegment
+ * Configuration of one segment
+ */
+typedef struct
+{
+    SegmentType Type;
+    uint32_t Duration;      ///< Duration [tick]
+    float Position;         ///< Position (Hold) or center position (Sine)
+    float Amplitude;        ///< Amplitude (Sine)
+    float Frequency;        ///< Frequency [Hz] (Sine)
+} TrajectorySegment;
+
+/**
+ * @struct TrajectorySource
+ * State of periodic trajectory source
+ */
+typedef struct
+{
+    const TrajectorySegment* pSegments;
+    uint32_t NumSegments;
+    float Ts;               ///< Sampling time [s]
+
+    uint32_t Index;         ///< Present segment
+    uint32_t Tick;          ///< Elapsed ticks in present segment
+
+    // Sine segment
+    uint32_t PhaseStep;     ///< Phase increment per tick (2^32 = 1 cycle), phase is Tick * PhaseStep
+    float Cos, Sin;         ///< Phasor of present phase
+    float dCos, dSin;       ///< Rotation per tick
+    float Omega;            ///< Angular frequency [rad/s]
+    float Omega2;           ///< Square of angular frequency [rad^2/s^2]
+} TrajectorySource;
+
+/**
+ * @struct TrajectoryCountSegment
+ * Segment converted into counts (count source)
+ */
+typedef struct
+{
+    SegmentType Type;
+    uint32_t Duration;      ///< Duration [tick]
+    int32_t Position;       ///< Position (Hold) or center position (Sine) [count]
+    int32_t Amplitude;      ///< Amplitude of position [count]
+    int32_t VelAmplitude;   ///< Amplitude of velocity [count/s]
+    int32_t AccAmplitude;   ///< Amplitude of acceleration [count/s^2]
+    uint32_t PhaseStep;     ///< Phase increment per tick (2^32 = 1 cycle)
+} TrajectoryCountSegment;
+
+/**
+ * @struct TrajectoryCountSource
+ * State of periodic trajectory source in counts
+ */
+typedef struct
+{
+    TrajectoryCountSegment Segments[TRAJECTORY_MAX_SEGMENTS];
+    uint32_t NumSegments;
+
+    uint32_t Index;         ///< Present segment
+    uint32_t Tick;          ///< Elapsed ticks in present segment
+} TrajectoryCountSource;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void initTrajectory(TrajectorySource*, const TrajectorySegment*, uint32_t, float);
+void calcTrajectory(TrajectorySource*, uint32_t, float*, float*, float*);
+int initTrajectoryCount(TrajectoryCountSource*, const TrajectorySegment*, uint32_t, float, float);
+void calcTrajectoryCount(TrajectoryCountSource*, uint32_t, int32_t*, int32_t*, int32_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRAJECTORY_H */
+/***************************************************************END OF FILE****/
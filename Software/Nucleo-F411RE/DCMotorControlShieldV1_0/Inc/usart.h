@@ -72,7 +72,7 @@ extern void _Error_Handler(char *, int);
 void MX_USART2_UART_Init(void);
 
 /* USER CODE BEGIN Prototypes */
-
+int readSerialChar(void);
 /* USER CODE END Prototypes */
 
 #ifdef __cplusplus
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file    velocity_estimator.h
+ * @brief   Header file of velocity estimators using timestamped encoder samples
+ * @details Both estimators use the free-running encoder count and the time when the sample was received,
+ *          so the velocity is not affected by the jitter of I2C transfer or missed samples.
+ *          - M/T method : count difference divided by the exact time between samples where the count changed.
+ *            The window is at least MinWindow, and at low speed it is extended until the count changes.
+ *          - Tracking loop (PLL) : type-2 loop which tracks position with zero steady-state lag for constant velocity.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __VELOCITY_ESTIMATOR_H
+#define __VELOCITY_ESTIMATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+/* Exported macro ------------------------------------------------------------*/
+#define MT_EDGE_BUFFER_SIZE     8       ///< Number of count changes kept by M/T method (power of 2)
+#define MT_ESTIMATOR_TIMEOUT    0.1f    ///< Velocity of M/T method is 0 if count does not change for this time [s]
+
+/* Exported types ------------------------------------------------------------*/
+/* Exported enum tag ---------------------------------------------------------*/
+/* Exported struct/union tag -------------------------------------------------*/
+/**
+ * @struct MTEstimator
+ * State of M/T method velocity estimator
+ */
+typedef struct
+{
+    float VelocityPerCountCycle;            ///< Resolution * timestamp frequency [rad*cycle/(count*s)]
+    uint32_t MinWindow;                     ///< Minimum measurement window [cycle]
+    uint32_t Timeout;                       ///< Timeout of count change [cycle]
+
+    uint32_t EdgeCount[MT_EDGE_BUFFER_SIZE];    ///< Counts of samples where the count changed
+    uint32_t EdgeTime[MT_EDGE_BUFFER_SIZE];     ///< Timestamps of samples where the count changed [cycle]
+    uint32_t NumEdges;                      ///< Number of valid edges
+    uint32_t EdgeIndex;                     ///< Index of next edge
+    uint32_t PrevTimestamp;                 ///< Timestamp of previous sample [cycle]
+    float Velocity;                         ///< Velocity [rad/s]
+    bool isInitialized;
+} MTEstimator;
+
+/**
+ * @struct PLLEstimator
+ * State of tracking loop (PLL) velocity estimator
+ */
+typedef struct
+{
+    float Resolution;                       ///< [rad/count]
+    float SecPerCycle;                      ///< Period of timestamp [s/cycle]
+    float Kp;                               ///< Proportional gain : 2*Bandwidth [1/s]
+    float Ki;                               ///< Integral gain : Bandwidth^2 [1/s^2]
+    float MaxDt;                            ///< The loop is restarted if sample interval exceeds this value [s]
+
+    uint32_t PositionCount;                 ///< Integer part of estimated position [count]
+    float PositionFrac;                     ///< Fractional part of estimated position [count]
+    float Velocity;                         ///< Estimated velocity [count/s]
+    uint32_t PrevTimestamp;                 ///< Timestamp of previous sample [cycle]
+    bool isInitialized;
+} PLLEstimator;
+
+/* Exported variables --------------------------------------------------------*/
+/* Exported function prototypes ----------------------------------------------*/
+void initMTEstimator(MTEstimator*, float, float, float);
+void resetMTEstimator(MTEstimator*);
+float calcMTEstimator(MTEstimator*, uint32_t, uint32_t);
+
+void initPLLEstimator(PLLEstimator*, float, float, float);
+void resetPLLEstimator(PLLEstimator*);
+float calcPLLEstimator(PLLEstimator*, uint32_t, uint32_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VELOCITY_ESTIMATOR_H */
+/***************************************************************END OF FILE****/
@@ -12,6 +12,8 @@
  */
 
 /* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
 /* Include user header files -------------------------------------------------*/
 #include "CurrentSenseAmp_INA181.h"
 #include "adc.h"
@@ -30,6 +32,7 @@
 /* Exported variables --------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static float CurrentPinOffsetVoltage = V_OFFSET_DEFAULT; ///< Offset voltage of Vref Pin when motor current is 0 [V]
+static int32_t CurrentPinOffsetCount = (int32_t) (V_OFFSET_DEFAULT / ADC_VCC * ADC_RESOLUTION + 0.5f); ///< Offset ADC count of Vref Pin
 
 /* Private function prototypes -----------------------------------------------*/
 /* Exported functions --------------------------------------------------------*/
@@ -41,10 +44,33 @@ float readCurrentResponse(void)
 {
     static float DiffVoltage;
     static const float DiffVoltage2CurrentResponse = 1.0f / CUR_AMP_GAIN / R_SHUNT;
+    ADC1Data data;
 
-    DiffVoltage = CurrentPinVoltage - CurrentPinOffsetVoltage;
+    readADC1Data(&data);
+    DiffVoltage = data.CurrentPinVoltage - CurrentPinOffsetVoltage;
     return ((-1.0f) * DiffVoltage * DiffVoltage2CurrentResponse);
 }
 
+/**
+ * @brief       Read current response as ADC count (without floating-point calculation)
+ * @return      Current response [count] (multiply getCurrentResponseResolution() to convert into [A])
+*/
+int32_t readCurrentResponseCount(void)
+{
+    ADC1Data data;
+
+    readADC1Data(&data);
+    return CurrentPinOffsetCount - (int32_t) data.CurrentPinCount;
+}
+
+/**
+ * @brief       Get resolution of current response
+ * @return      Current per ADC count [A/count]
+*/
+float getCurrentResponseResolution(void)
+{
+    return ADC_VCC / (float) ADC_RESOLUTION / CUR_AMP_GAIN / R_SHUNT;
+}
+
 /* Private functions ---------------------------------------------------------*/
 /***************************************************************END OF FILE****/
@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file    DOB.c
+ * @brief   Source file of disturbance observer and reaction torque observer
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+/* Include user header files -------------------------------------------------*/
+#include "DOB.h"
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Set coefficients of disturbance observer at runtime
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   Gdob Cutoff frequency [rad/s]
+ * @param[in]   M Nominal inertia [Nm/s^2*rad]
+ * @param[in]   Kt Nominal torque constant [Nm/A]
+ * @param[in]   Ts Sampling time [s]
+*/
+void setDOBCoeffs(DOBCoeffs* pCoeffs, float Gdob, float M, float Kt, float Ts)
+{
+    const DOBCoeffs Coeffs = DOB_COEFFS(Gdob, M, Kt, Ts);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Reset disturbance observer (estimated disturbance becomes 0)
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[out]  pState Pointer of state
+ * @param[in]   Velocity Present velocity response [rad/s]
+*/
+void resetDOB(const DOBCoeffs* pCoeffs, DOBState* pState, float Velocity)
+{
+    pState->Filter = pCoeffs->K * Velocity;
+    pState->CurrentCmd = 0.0f;
+    pState->Disturbance = 0.0f;
+}
+
+/**
+ * @brief       Disturbance observer
+ * @details     Previous current command is used as the input of the plant, since it has been applied until this step.
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   CurrentRef Current reference from major loop controller [A]
+ * @param[in]   Velocity Velocity response [rad/s]
+ * @return      Current command compensated by estimated disturbance [A]
+*/
+float calcDOB(const DOBCoeffs* pCoeffs, DOBState* pState, float CurrentRef, float Velocity)
+{
+    float KVelocity = pCoeffs->K * Velocity;
+
+    pState->Filter = pCoeffs->A * pState->Filter + pCoeffs->B * (pState->CurrentCmd + KVelocity);
+    pState->Disturbance = pState->Filter - KVelocity;
+    pState->CurrentCmd = CurrentRef + pState->Disturbance;
+    return pState->CurrentCmd;
+}
+
+/**
+ * @brief       Set coefficients of reaction torque observer
+ * @note        Use resetDOB to reset state of reaction torque observer.
+ * @param[out]  pCoeffs Pointer of coefficients
+ * @param[in]   Gdob Cutoff frequency [rad/s]
+ * @param[in]   M Nominal inertia [Nm/s^2*rad]
+ * @param[in]   Kt Nominal torque constant [Nm/A]
+ * @param[in]   Coulomb Coulomb friction torque [Nm]
+ * @param[in]   Viscous Viscous friction coefficient [Nm*s/rad]
+ * @param[in]   VelocityBand Velocity where Coulomb friction is saturated (> 0) [rad/s]
+ * @param[in]   Ts Sampling time [s]
+*/
+void setRTOBCoeffs(RTOBCoeffs* pCoeffs, float Gdob, float M, float Kt, float Coulomb, float Viscous,
+        float VelocityBand, float Ts)
+{
+    const RTOBCoeffs Coeffs = RTOB_COEFFS(Gdob, M, Kt, Coulomb, Viscous, VelocityBand, Ts);
+    *pCoeffs = Coeffs;
+}
+
+/**
+ * @brief       Reaction torque observer
+ * @details     Coulomb friction is linear around zero velocity so that the estimate does not chatter at standstill.
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pState Pointer of state
+ * @param[in]   Current Current response [A]
+ * @param[in]   Velocity Velocity response [rad/s]
+ * @return      External load torque (positive : load resists positive rotation) [Nm]
+*/
+float calcRTOB(const RTOBCoeffs* pCoeffs, DOBState* pState, float Current, float Velocity)
+{
+    float KVelocity = pCoeffs->Observer.K * Velocity;
+
+    pState->Filter = pCoeffs->Observer.A * pState->Filter + pCoeffs->Observer.B * (pState->CurrentCmd + KVelocity);
+    pState->Disturbance = pState->Filter - KVelocity;
+    pState->CurrentCmd = Current;
+
+    float Sign = Velocity * pCoeffs->InvVelocityBand;
+    if (Sign > 1.0f)
+        Sign = 1.0f;
+    else if (Sign < -1.0f)
+        Sign = -1.0f;
+    float Friction = pCoeffs->Coulomb * Sign + pCoeffs->Viscous * Velocity;
+
+    return pCoeffs->Kt * pState->Disturbance - Friction;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/***************************************************************END OF FILE****/
@@ -26,6 +26,9 @@
 /********** Hardware-specific parameters **********/
 #define TB6612_htim             htim3
 #define TB6612_PWM_CH           TIM_CHANNEL_2
+#define TB6612_PWM_CCR          CCR2
+#define TB6612_PWM_CCMR         CCMR1
+#define TB6612_PWM_OCPE         TIM_CCMR1_OC2PE
 #define TB6612_AIN1_GPIOPort    GPIOA
 #define TB6612_AIN1_GPIOPinMask LL_GPIO_PIN_8
 #define TB6612_AIN2_GPIOPort    GPIOA
@@ -39,86 +42,169 @@ extern TIM_HandleTypeDef TB6612_htim;
 /* Private struct/union tag --------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+static volatile MotorOutputState OutputState = Coast_MotorOutput;
+static float Voltage2Pulse;     ///< Conversion factor from motor voltage to compare value [1/V]
+static uint32_t MaxPulse;       ///< Compare value for 100% duty
+
 /* Private function prototypes -----------------------------------------------*/
-static inline void stopPWM(void);
-static inline void setPWMduty(float);
+static inline void setOutputState(MotorOutputState);
 
 /* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialize motor driver
+ * @note        PWM timer keeps running after this function is called,
+ *              because TIM3 update event triggers ADC1 conversion (current response) and minor loop
+*/
+void initMotorDriver(void)
+{
+    MaxPulse = TB6612_htim.Init.Period + 1;
+    Voltage2Pulse = (float) MaxPulse / Vm;
+
+    // Compare value and period are updated at update event (glitch-free)
+    TB6612_htim.Instance->TB6612_PWM_CCMR |= TB6612_PWM_OCPE;
+    TB6612_htim.Instance->CR1 |= TIM_CR1_ARPE;
+
+    OutputState = Coast_MotorOutput;
+    setOutputState(ShortBrake_MotorOutput);
+
+    if (HAL_TIM_PWM_Start(&TB6612_htim, TB6612_PWM_CH) != HAL_OK) {
+        printf("HAL_TIM_PWM_Start error\r\n");
+    }
+}
+
 /**
  * @brief       Set voltage to motor
+ * @note        Only compare register is written every call.
+ *              AIN1/AIN2 pins are written only when rotation direction is changed.
  * @param[in]   V Motor voltage
 */
 inline void setMotorVoltage(float V)
 {
-    float Vout;
+    if (V > Vm)
+        V = Vm;
+    else if (V < -Vm)
+        V = -Vm;
+    setMotorPulse((int32_t) (V * Voltage2Pulse));
+}
 
-    if (V > 0.0f) {
+/**
+ * @brief       Set PWM compare value with sign to motor (without floating-point calculation)
+ * @note        Only compare register is written every call (applied at the next update event).
+ *              AIN1/AIN2 pins are written only when rotation direction is changed.
+ *              In that case the compare value is applied immediately (preload is disabled for the write),
+ *              so the duty of the previous direction is not output in the new direction for the rest of the period.
+ * @param[in]   Pulse Signed compare value (-getMaxMotorPulse() ~ getMaxMotorPulse())
+*/
+inline void setMotorPulse(int32_t Pulse)
+{
+    MotorOutputState state;
+    uint32_t pulse;
+
+    if (Pulse > 0) {
         // CW(CCW)
-        Vout = V;
-        LL_GPIO_SetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
-        LL_GPIO_ResetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
-    } else {
+        pulse = (uint32_t) Pulse;
+        state = Forward_MotorOutput;
+    } else if (Pulse < 0) {
         // CCW(CW)
-        Vout = -V;
-        LL_GPIO_ResetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
-        LL_GPIO_SetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
+        pulse = (uint32_t) (-Pulse);
+        state = Reverse_MotorOutput;
+    } else {
+        // Keep direction
+        pulse = 0;
+        state = ((OutputState == Forward_MotorOutput) || (OutputState == Reverse_MotorOutput)) ? OutputState : Forward_MotorOutput;
+    }
+
+    if (pulse > MaxPulse)
+        pulse = MaxPulse;
+    if (state == OutputState) {
+        TB6612_htim.Instance->TB6612_PWM_CCR = pulse;
+        return;
     }
 
-    if (Vout > Vm)
-        Vout = Vm;
-    setPWMduty(Vout / Vm);
+    // Output is stopped while AIN1/AIN2 are changed, then the new compare value is applied to the present period
+    TB6612_htim.Instance->TB6612_PWM_CCMR &= ~TB6612_PWM_OCPE;
+    TB6612_htim.Instance->TB6612_PWM_CCR = 0;
+    setOutputState(state);
+    TB6612_htim.Instance->TB6612_PWM_CCR = pulse;
+    TB6612_htim.Instance->TB6612_PWM_CCMR |= TB6612_PWM_OCPE;
+}
+
+/**
+ * @brief       Get compare value for 100% duty
+ * @return      Maximum compare value
+*/
+int32_t getMaxMotorPulse(void)
+{
+    return (int32_t) (TB6612_htim.Init.Period + 1);
 }
 
 /**
- * @brief       Stop motor
+ * @brief       Get conversion factor from motor voltage to compare value
+ * @return      Compare value per voltage [1/V]
+*/
+float getMotorPulsePerVoltage(void)
+{
+    return (float) (TB6612_htim.Init.Period + 1) / Vm;
+}
+
+/**
+ * @brief       Stop motor (short brake)
 */
 inline void stopMotor(void)
 {
-    // Short brake
-    LL_GPIO_SetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
-    LL_GPIO_SetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
-    stopPWM();
+    setOutputState(ShortBrake_MotorOutput);
 }
-/***** Interrupt function prototypes *****/
-/* Private functions ---------------------------------------------------------*/
+
 /**
- * @brief       Stop PWM
+ * @brief       Release motor (coast, output is high impedance)
 */
-static inline void stopPWM(void)
+inline void coastMotor(void)
 {
-    HAL_StatusTypeDef status;
-    status = HAL_TIM_PWM_Stop(&TB6612_htim, TB6612_PWM_CH);
-    if (status != HAL_OK) {
-        printf("HAL_TIM_PWM_Stop error : %d\r\n", status);
-    }
+    setOutputState(Coast_MotorOutput);
 }
 
 /**
- * @brief       Set PWM duty
- * @param[in]   PWM ratio (0.0 ~ 1.0)
+ * @brief       Get present output state of motor driver
+ * @return      Output state
 */
-static inline void setPWMduty(float ratio)
+MotorOutputState getMotorOutputState(void)
 {
-    if(ratio < 0.0f)
-        ratio = 0.0f;
-    if (ratio > 1.0f)
-        ratio = 1.0f;
-
-    TIM_OC_InitTypeDef sConfigOC;
-    sConfigOC.OCMode = TIM_OCMODE_PWM1;
-    sConfigOC.Pulse = ratio * (TB6612_htim.Init.Period + 1) - 1;
-    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
-    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
-
-    HAL_StatusTypeDef status;
-    status = HAL_TIM_PWM_ConfigChannel(&TB6612_htim, &sConfigOC, TB6612_PWM_CH);
-    if (status != HAL_OK) {
-        printf("HAL_TIM_PWM_ConfigChannel error : %d\r\n", status);
-    }
-    status = HAL_TIM_PWM_Start(&TB6612_htim, TB6612_PWM_CH);
-    if (status != HAL_OK) {
-        printf("HAL_TIM_PWM_Start error : %d\r\n", status);
+    return OutputState;
+}
+
+/***** Interrupt function prototypes *****/
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Change output state of motor driver
+ * @param[in]   state New output state
+*/
+static inline void setOutputState(MotorOutputState state)
+{
+    if (state == OutputState)
+        return;
+
+    switch (state) {
+        case Forward_MotorOutput:
+            LL_GPIO_SetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
+            LL_GPIO_ResetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
+            break;
+        case Reverse_MotorOutput:
+            LL_GPIO_ResetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
+            LL_GPIO_SetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
+            break;
+        case ShortBrake_MotorOutput:
+            TB6612_htim.Instance->TB6612_PWM_CCR = 0;
+            LL_GPIO_SetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
+            LL_GPIO_SetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
+            break;
+        case Coast_MotorOutput:
+        default:
+            TB6612_htim.Instance->TB6612_PWM_CCR = 0;
+            LL_GPIO_ResetOutputPin(TB6612_AIN1_GPIOPort, TB6612_AIN1_GPIOPinMask);
+            LL_GPIO_ResetOutputPin(TB6612_AIN2_GPIOPort, TB6612_AIN2_GPIOPinMask);
+            break;
     }
+    OutputState = state;
 }
 
 /***************************************************************END OF FILE****/
@@ -15,10 +15,14 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
 /* Include user header files -------------------------------------------------*/
 #include "RotaryEncoder_AS5600.h"
 #include "i2c.h"
+#include "tim.h"
+#include "snapshot.h"
 
 /* Private function macro ----------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
@@ -36,48 +40,157 @@
 #define AS5600_REG_AGC          0x1A
 #define AS5600_REG_MAGNITUDE    0x1B
 #define AS5600_REG_BURN         0xFF
+#define AS5600_CONF_OUTS_ANALOG_REDUCED 0x10    // OUTS = 0b01 : Analog output 10% ~ 90% of VDD
+
+// Analog output sampled by ADC (AS5600 and ADC share 3.3V supply, so the output is ratiometric to ADC count)
+#define AS5600_ANALOG_MIN_COUNT 410     // 10% of ADC range : 0 [count]
+#define AS5600_ANALOG_SPAN_COUNT 3277   // 80% of ADC range : one revolution
+#define AS5600_ANALOG_VALID_MIN 205     // Below 5% : Open wire or not in analog output mode
+#define AS5600_ANALOG_VALID_MAX 3891    // Above 95% : Short to VDD
+#define AS5600_ANALOG_AGREE_COUNT 16    // Analog output agrees with I2C read within this deviation [count]
+#define AS5600_ANALOG_VALIDATE_SAMPLES 100  // Consecutive agreeing I2C reads to use analog output again (20[ms])
 
 #define AS5600_hi2c                     hi2c1
-#define AS5600_I2C_MemRxCpltCallback    I2C1_MemRxCpltCallback
 #define AS5600_I2C_ErrorCallback        I2C1_ErrorCallback
+#define AS5600_I2C_EV_UserIRQHandler    I2C1_EV_UserIRQHandler
+#define AS5600_I2C_ER_UserIRQHandler    I2C1_ER_UserIRQHandler
+#define AS5600_I2C_RxDMA_UserIRQHandler I2C1_RxDMA_UserIRQHandler
+#define AS5600_I2C_RecoverBusStep       I2C1_RecoverBusStep
+#define AS5600_I2C                      I2C1
+#define AS5600_DMA_STREAM               DMA1_Stream0    // I2C1_RX (channel 1, configured by HAL_I2C_MspInit)
+#define AS5600_DMA_ISR                  (DMA1->LISR)
+#define AS5600_DMA_IFCR                 (DMA1->LIFCR)
+#define AS5600_DMA_FLAG_TC              DMA_LISR_TCIF0
+#define AS5600_DMA_FLAG_TE              DMA_LISR_TEIF0
+#define AS5600_DMA_FLAGS_ALL            (DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0)
+#define AS5600_I2C_ERROR_FLAGS          (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT)
+#define AS5600_htim                     htim4   // Sampling timer (slave of TIM3, so the sampling phase is fixed to PWM period)
+#define AS5600_TIM_PeriodElapsedCallback TIM4_PeriodElapsedCallback
 
 // Timeout
-#define AS5600_I2C_TIMEOUT_MS   5000
+#define AS5600_I2C_TIMEOUT_MS   10      // Blocking reads of initialization
+#define AS5600_INIT_RETRIES     3       // Initialization fails after this number of retries with bus recovery
+#define AS5600_READ_TIMEOUT_PERIODS 4   // Periodic read is aborted if not completed within this number of sampling periods
+
+#if (AS5600_SAMPLE_BUFFER_SIZE & (AS5600_SAMPLE_BUFFER_SIZE - 1)) != 0
+#error AS5600_SAMPLE_BUFFER_SIZE must be power of 2
+#endif
+
+// Correction table in flash (16[KB] sector 1 is reserved by linker script)
+#define AS5600_CORRECTION_SECTOR    FLASH_SECTOR_1
+#define AS5600_CORRECTION_MAGIC     0x30303635  // "5600"
+#if ENCODER_CORRECTION_TABLE_SIZE != AS5600_RESOLUTION_PPR
+#error ENCODER_CORRECTION_TABLE_SIZE must be the resolution of AS5600
+#endif
 
 /* Imported variables --------------------------------------------------------*/
 extern I2C_HandleTypeDef AS5600_hi2c;
+extern TIM_HandleTypeDef AS5600_htim;
+extern const struct CorrectionTableData _encoder_calibration;  // Defined by linker script
 
 /* Private types -------------------------------------------------------------*/
 /* Private enum tag ----------------------------------------------------------*/
+/**
+ * @enum ReadPhase
+ * Phase of periodic read by register-level driver
+ */
+typedef enum
+{
+    Idle_ReadPhase = 0,     ///< No read in progress (HAL may use the bus)
+    Register_ReadPhase,     ///< START, address (write) and register address
+    Data_ReadPhase          ///< Repeated START, address (read) and 2 bytes by DMA
+} ReadPhase;
+
 /* Private struct/union tag --------------------------------------------------*/
+/**
+ * @struct CountSample
+ * Count sum and its timestamp handed from I2C interrupt to control loop
+ */
+typedef struct
+{
+    int64_t CountSum;       ///< Multi-turn count
+    uint32_t Timestamp;     ///< DWT cycle counter when the read was started
+} CountSample;
+
+/**
+ * @struct CorrectionTableData
+ * Correction table stored in flash (Magic is programmed last, so an interrupted write is not valid)
+ */
+struct CorrectionTableData
+{
+    uint32_t Magic;         ///< AS5600_CORRECTION_MAGIC
+    uint32_t Size;          ///< AS5600_RESOLUTION_PPR
+    uint32_t CRC32;         ///< CRC-32 of Size and Correction
+    int8_t Correction[AS5600_RESOLUTION_PPR];   ///< Added to position response (subtracted from raw angle) [count]
+};
+
 /* Exported variables --------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static volatile uint8_t Encoder_Buff[2];
 static volatile bool hasError_I2C = false;
 static volatile uint16_t AbsoluteAngleCount, AbsoluteAngleCountPrev;
-static volatile int64_t AbsoluteCountSum, AbsoluteCountSum_offset;
+static int64_t AbsoluteCountSum;                    // Written only in I2C interrupt (after initialization)
+static int64_t AbsoluteCountSum_offset;
+static CountSample SampleBuffer[AS5600_SAMPLE_BUFFER_SIZE];  // Written only in I2C interrupt (after initialization)
+static volatile uint32_t SampleHead = 0;            // Number of stored samples (index of the next sample)
+static volatile uint32_t ReadTimestamp;             // DWT cycle counter when the read in progress was started
+static volatile ReadPhase RawAngleReadPhase = Idle_ReadPhase;   // Completion flag of periodic read (accessed only in interrupts)
+static uint32_t RecoveryStep = 0;                   // Step of bus recovery (accessed only in sampling timer interrupt)
+static volatile EncoderHealth Health = Fault_EncoderHealth;     // Fault until initialization succeeds
+static EncoderErrorStats ErrorStats;                // Written only in interrupts (after initialization)
+static SNAPSHOT(EncoderErrorStats) ErrorStatsSnapshot;  // Published by sampling timer interrupt (initialization before it)
+static const int8_t* volatile CorrectionTable = NULL;   // NULL : angle is not corrected
+static bool isCorrectionTableValid = false;
+#if USE_ENCODER_ANALOG_OUTPUT
+static volatile bool isAnalogOutputValid = true;    // Cleared by ADC interrupt when the output goes out of range, set again by I2C read
+static volatile uint16_t AnalogAngleCount;          // Latest raw angle of analog output (written only in ADC interrupt)
+static volatile uint32_t AnalogOutOfRangeCount = 0; // Number of out-of-range samples (written only in ADC interrupt)
+static volatile int16_t AnalogDeviation;            // Raw angle of I2C - raw angle of analog output [count]
+#endif
 
 // constant variables to reduce calculation time
 static const float AbsoluteAngleCount2PositionRes = 2.0f * 3.14159265358979323846f / (float) AS5600_RESOLUTION_PPR;
 
 /* Private function prototypes -----------------------------------------------*/
 static inline void updateRawAngleCount(uint16_t*, uint16_t*, int64_t*);
+static inline void storeCountSample(int64_t, uint32_t);
+static inline int loadCountSample(CountSample*, uint32_t);
+static inline bool startRawAngleRead(void);
+static inline void abortRawAngleRead(void);
+static inline void recoverBus(void);
+static inline void updateEncoderHealth(void);
+static inline uint16_t correctAngleCount(uint16_t);
+static inline uint32_t calcCorrectionCRC(const int8_t*);
+#if USE_ENCODER_ANALOG_OUTPUT
+static inline int16_t calcAngleDeviation(uint16_t, uint16_t);
+static inline void validateAnalogOutput(uint16_t);
+#endif
 
 /* Exported functions --------------------------------------------------------*/
 /**
  * @brief       Initialize encoder AS5600
+ * @note        Periodic reads are started by the sampling timer after this function is called.
 */
 void initEncoder(void)
 {
     HAL_StatusTypeDef status;
     uint8_t AS5600_status;
+    uint32_t Retry = 0;
+
+    // Start DWT cycle counter for timestamps (also used by loop profiler)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
 AS5600_init_start:
     // Read AS5600 status register
     status = HAL_I2C_Mem_Read(&AS5600_hi2c, AS5600_DEV_ADDRESS, AS5600_REG_STATUS,
             I2C_MEMADD_SIZE_8BIT, &AS5600_status, 1, AS5600_I2C_TIMEOUT_MS);
     if (status != HAL_OK) {
         printf("HAL_I2C_Mem_Read error\r\n");
+        if (++Retry > AS5600_INIT_RETRIES)
+            goto AS5600_init_error;
 
+        // Bus is recovered by HAL_I2C_MspInit
         if (HAL_I2C_DeInit(&AS5600_hi2c) != HAL_OK) {
             printf("HAL_I2C_DeInit error\r\n");
         }
@@ -96,13 +209,17 @@ AS5600_init_start:
             printf("Magnet too weak\r\n");
         if (AS5600_status & 0x08)
             printf("Magnet too strong\r\n");
-        for (;;);
+        goto AS5600_init_error;
     } else {
         //printf("Magnet : OK\r\n");
     }
 
-    // Set AS5600 configuration (WD = 0b0, FTH = 0b001, SF = 0b11, PM=0b00, HYST=0b00, OUTS=0b00, PWMF=0b00)
+    // Set AS5600 configuration (WD = 0b0, FTH = 0b001, SF = 0b11, PM=0b00, HYST=0b00, OUTS=0b00 or 0b01, PWMF=0b00)
+#if USE_ENCODER_ANALOG_OUTPUT
+    const uint8_t AS5600_CONF[2] = { 0x07, AS5600_CONF_OUTS_ANALOG_REDUCED };
+#else
     const uint8_t AS5600_CONF[2] = { 0x07, 0x00 };
+#endif
     status = HAL_I2C_Mem_Read(&AS5600_hi2c, AS5600_DEV_ADDRESS, AS5600_REG_CONF, I2C_MEMADD_SIZE_8BIT,
             (uint8_t*)Encoder_Buff, 2, AS5600_I2C_TIMEOUT_MS);
     assert_param(status == HAL_OK);
@@ -119,12 +236,40 @@ AS5600_init_start:
     // Set current position as origin(PositionRes = 0)
     status = HAL_I2C_Mem_Read(&AS5600_hi2c, AS5600_DEV_ADDRESS, AS5600_REG_RAW_ANGLE,
             I2C_MEMADD_SIZE_8BIT, (uint8_t*)Encoder_Buff, 2, AS5600_I2C_TIMEOUT_MS);
-    if (status != HAL_OK)
-        printf("HAL_I2C_Mem_Read_DMA error : %d\r\n", status);
+    if (status != HAL_OK) {
+        printf("HAL_I2C_Mem_Read error : %d\r\n", status);
+        goto AS5600_init_error;
+    }
+    // Correction table is used if it has been written by writeEncoderCorrectionTable
+    if ((_encoder_calibration.Magic == AS5600_CORRECTION_MAGIC) && (_encoder_calibration.Size == AS5600_RESOLUTION_PPR)
+            && (_encoder_calibration.CRC32 == calcCorrectionCRC(_encoder_calibration.Correction))) {
+        isCorrectionTableValid = true;
+        CorrectionTable = _encoder_calibration.Correction;
+    }
+
     AbsoluteAngleCount = (uint16_t) Encoder_Buff[0] << 8 | (uint16_t) Encoder_Buff[1];
-    AbsoluteAngleCount &= 0x0FFF;
-    updateRawAngleCount((uint16_t *)&AbsoluteAngleCount, (uint16_t*)&AbsoluteAngleCountPrev, (int64_t*)&AbsoluteCountSum);
+    AbsoluteAngleCount = correctAngleCount(AbsoluteAngleCount & 0x0FFF);
+    updateRawAngleCount((uint16_t *)&AbsoluteAngleCount, (uint16_t*)&AbsoluteAngleCountPrev, &AbsoluteCountSum);
+    storeCountSample(AbsoluteCountSum, DWT->CYCCNT);
     AbsoluteCountSum_offset = AbsoluteCountSum;
+#if USE_ENCODER_ANALOG_OUTPUT
+    AnalogAngleCount = AbsoluteAngleCount;
+#endif
+
+    // Sampling timer is started by the next TIM3 update event (slave trigger mode), so only the interrupt is enabled here
+    Health = Healthy_EncoderHealth;
+    writeSnapshot(&ErrorStatsSnapshot, ErrorStats);
+    __HAL_TIM_CLEAR_FLAG(&AS5600_htim, TIM_FLAG_UPDATE);
+    __HAL_TIM_ENABLE_IT(&AS5600_htim, TIM_IT_UPDATE);
+    return;
+
+AS5600_init_error:
+    // Periodic reads are not started, so the health stays Fault and control is not enabled
+    Health = Fault_EncoderHealth;
+    HAL_GPIO_WritePin(EncErr_GPIO_Port, EncErr_Pin, GPIO_PIN_SET);
+    ErrorStats.Faults++;
+    writeSnapshot(&ErrorStatsSnapshot, ErrorStats);
+    printf("Encoder initialization error\r\n");
 }
 
 
@@ -136,61 +281,350 @@ AS5600_init_start:
 */
 int readPositionResponse(float* pPosRes)
 {
-    static float PositionRes_buf;
-    PositionRes_buf = AbsoluteAngleCount2PositionRes * (float) (AbsoluteCountSum - AbsoluteCountSum_offset);
+    int32_t Count;
+    int ret = readPositionResponseCount(&Count);
+    if (ret == 0)
+        *pPosRes = AbsoluteAngleCount2PositionRes * (float) Count;
+    return ret;
+}
+
+/**
+ * @brief       Read position response as encoder count (without floating-point calculation)
+ * @param[in,out] pCount Pointer of position response [count] (multiply getPositionResponseResolution() to convert into [rad])
+ * @retval      0 Success to read, position response is stored to pCount
+ * @retval      otherwise Failed to read
+*/
+int readPositionResponseCount(int32_t* pCount)
+{
+    EncoderSample Sample;
+    int ret = readEncoderSample(&Sample);
+    if (ret == 0)
+        *pCount = Sample.Count;
+    return ret;
+}
+
+/**
+ * @brief       Read the latest position response with free-running count, timestamp and age (for velocity estimation)
+ * @note        While the bus is being recovered, the last good sample is returned (its age increases).
+ * @param[out]  pSample Pointer of encoder sample
+ * @retval      0 Success to read, sample is stored to pSample
+ * @retval      otherwise Failed to read (health is Fault, or no sample is available)
+*/
+int readEncoderSample(EncoderSample* pSample)
+{
+    if (Health == Fault_EncoderHealth)
+        return -1;
+    return readEncoderSampleHistory(pSample, 0);
+}
+
+/**
+ * @brief       Read a past sample from ring buffer
+ * @param[out]  pSample Pointer of encoder sample
+ * @param[in]   Depth 0 : latest sample, n : n-th sample before the latest one (less than AS5600_SAMPLE_BUFFER_SIZE - 1)
+ * @retval      0 Success to read, sample is stored to pSample
+ * @retval      -1 The sample is not available
+*/
+int readEncoderSampleHistory(EncoderSample* pSample, uint32_t Depth)
+{
+    CountSample sample;
+    if (loadCountSample(&sample, Depth))
+        return -1;
+    pSample->Count = (int32_t) (sample.CountSum - AbsoluteCountSum_offset);
+    pSample->AbsoluteCount = (uint32_t) sample.CountSum;
+    pSample->Timestamp = sample.Timestamp;
+    pSample->Age = DWT->CYCCNT - sample.Timestamp;
+    pSample->Angle = (uint16_t) (-sample.CountSum) & (AS5600_RESOLUTION_PPR - 1);    // Count sum decreases as the angle increases
+    return 0;
+}
+
+/**
+ * @brief       Set the present motor position response to the desired value
+ * @note        Velocity calculation of caller should be rebased to the new position to avoid destabilization
+ * @param[in]   Position Desired position response
+*/
+void setPositionResponse(float Position)
+{
+    CountSample sample;
+    if (loadCountSample(&sample, 0))
+        return;     // Initialization failed
+    AbsoluteCountSum_offset = sample.CountSum - (int64_t) (Position / AbsoluteAngleCount2PositionRes);
+}
+
+/**
+ * @brief       Get resolution of position response
+ * @return      Position per encoder count [rad/count]
+*/
+float getPositionResponseResolution(void)
+{
+    return AbsoluteAngleCount2PositionRes;
+}
+
+/**
+ * @brief       Get frequency of timestamp of encoder sample
+ * @return      Frequency of DWT cycle counter [Hz]
+*/
+float getEncoderTimestampFrequency(void)
+{
+    return (float) SystemCoreClock;
+}
+
+/**
+ * @brief       Write correction table to flash and use it
+ * @note        Flash sector 1 (16[KB]) is erased, which stalls the CPU (including interrupts) for about 0.25 ~ 0.5[s],
+ *              so this function must be called from a low priority task after the motor is stopped
+ *              and the control loops are quiesced.
+ * @param[in]   pTable Correction table (ENCODER_CORRECTION_TABLE_SIZE elements), pTable[Angle] is added to position [count]
+ * @retval      0 : OK
+ * @retval      -1 : Failed to erase or program (correction is disabled)
+*/
+int writeEncoderCorrectionTable(const int8_t* pTable)
+{
+    FLASH_EraseInitTypeDef Erase;
+    uint32_t SectorError;
+    uint32_t Address = (uint32_t) &_encoder_calibration;
+    int ret = 0;
+
+    CorrectionTable = NULL;     // Table is not read while it is rewritten
+    isCorrectionTableValid = false;
+
+    HAL_FLASH_Unlock();
+    Erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    Erase.Sector = AS5600_CORRECTION_SECTOR;
+    Erase.NbSectors = 1;
+    Erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    if (HAL_FLASHEx_Erase(&Erase, &SectorError) != HAL_OK) {
+        ret = -1;
+    } else {
+        HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, Address + offsetof(struct CorrectionTableData, Size), AS5600_RESOLUTION_PPR);
+        if (status == HAL_OK)
+            status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, Address + offsetof(struct CorrectionTableData, CRC32), calcCorrectionCRC(pTable));
+        for (uint32_t i = 0; (status == HAL_OK) && (i < AS5600_RESOLUTION_PPR); i += 4) {
+            uint32_t Word;
+            memcpy(&Word, &pTable[i], sizeof(Word));    // pTable may not be aligned
+            status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, Address + offsetof(struct CorrectionTableData, Correction) + i, Word);
+        }
+        if (status == HAL_OK)
+            status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, Address + offsetof(struct CorrectionTableData, Magic), AS5600_CORRECTION_MAGIC);
+        if (status != HAL_OK)
+            ret = -1;
+    }
+    HAL_FLASH_Lock();
+
+    if ((ret == 0) && (_encoder_calibration.CRC32 == calcCorrectionCRC(_encoder_calibration.Correction))) {
+        isCorrectionTableValid = true;
+        CorrectionTable = _encoder_calibration.Correction;
+    } else {
+        printf("Encoder correction table write error\r\n");
+        ret = -1;
+    }
+    return ret;
+}
+
+/**
+ * @brief       Enable or disable correction of angle (e.g. disabled while calibrating)
+ * @note        Position response jumps by the correction of the present angle.
+ * @param[in]   isEnabled true : Corrected by the table in flash (if valid), false : Not corrected
+*/
+void enableEncoderCorrection(bool isEnabled)
+{
+    CorrectionTable = (isEnabled && isCorrectionTableValid) ? _encoder_calibration.Correction : NULL;
+}
+
+/**
+ * @brief       Get health of encoder
+ * @return      Healthy, Holding (last good sample is held) or Fault (control must be stopped)
+*/
+EncoderHealth getEncoderHealth(void)
+{
+    return Health;
+}
+
+/**
+ * @brief       Read error statistics
+ * @note        Consistent copy published every sampling period (errors of the present period are not included yet).
+ * @param[out]  pStats Pointer of error statistics
+*/
+void readEncoderErrorStats(EncoderErrorStats* pStats)
+{
+    readSnapshot(&ErrorStatsSnapshot, pStats);
+}
+
+#if USE_ENCODER_ANALOG_OUTPUT
+/**
+ * @brief       Read deviation between I2C and analog output (for diagnostics)
+ * @param[out]  pDeviation Pointer of raw angle of I2C - raw angle of analog output [count]
+ * @retval      0 Analog output is used for position response
+ * @retval      -1 Analog output is out of range, I2C is used for position response
+*/
+int readEncoderAnalogDeviation(int16_t* pDeviation)
+{
+    if (!isAnalogOutputValid)
+        return -1;
+    *pDeviation = AnalogDeviation;
+    return 0;
+}
+#endif
+
+/***** Interrupt function prototypes *****/
+/**
+ * @brief       When sampling period of the encoder has elapsed, this function is called
+ * @note        The read is skipped if the previous read has not completed or the bus is being recovered.
+ * @param[in,out] htim Pointer of TIM handler
+*/
+void AS5600_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    static uint32_t BusyPeriods = 0;
+    uint32_t Timestamp = DWT->CYCCNT;   // Take timestamp first to minimize jitter
+
+    updateEncoderHealth();
+    // Error statistics are written only by the encoder interrupts, which have the same priority as this one
+    writeSnapshot(&ErrorStatsSnapshot, ErrorStats);
 
-    // Preparation for reading the position response in the next control loop
     if (hasError_I2C) {
-        printf("I2C Error CallBack:0x%X,0x%X\r\n",
-                (unsigned int)HAL_I2C_GetState(&AS5600_hi2c), (unsigned int)HAL_I2C_GetError(&AS5600_hi2c));
-        // reset I2C bus
-        if (HAL_I2C_DeInit(&AS5600_hi2c) != HAL_OK) {
-            printf("HAL_I2C_DeInit error\r\n");
+        recoverBus();
+        BusyPeriods = 0;
+        return;
+    }
+    if (RawAngleReadPhase == Idle_ReadPhase) {
+        ReadTimestamp = Timestamp;
+        if (startRawAngleRead()) {
+            BusyPeriods = 0;
+            return;
         }
-        if (HAL_I2C_Init(&AS5600_hi2c) != HAL_OK) {
-            printf("HAL_I2C_Init error\r\n");
+    }
+    // Previous read has not completed or the bus is busy (the sample is skipped)
+    if (++BusyPeriods >= AS5600_READ_TIMEOUT_PERIODS) {
+        abortRawAngleRead();
+        ErrorStats.Timeouts++;
+        hasError_I2C = true;
+    }
+}
+
+/**
+ * @brief       I2C event interrupt of periodic read
+ * @retval      true : Handled (HAL handler must not be called)
+ * @retval      false : Not related to periodic read
+*/
+bool AS5600_I2C_EV_UserIRQHandler(void)
+{
+    if (RawAngleReadPhase == Idle_ReadPhase)
+        return false;
+
+    uint32_t SR1 = AS5600_I2C->SR1;
+    if (SR1 & I2C_SR1_SB) {
+        if (RawAngleReadPhase == Register_ReadPhase) {
+            AS5600_I2C->DR = AS5600_DEV_ADDRESS;
+        } else {
+            // DMA requests and NACK of the last byte are set before ADDR is cleared
+            AS5600_I2C->CR2 |= I2C_CR2_DMAEN | I2C_CR2_LAST;
+            AS5600_I2C->DR = AS5600_DEV_ADDRESS | 0x01;
         }
-        hasError_I2C = false;
-        return 1;
-    } else {
-        static HAL_StatusTypeDef status;
-        if ((HAL_I2C_GetState(&AS5600_hi2c) == HAL_I2C_STATE_READY) && (HAL_I2C_GetError(&AS5600_hi2c) == HAL_I2C_ERROR_NONE)) {
-            status = HAL_I2C_Mem_Read_DMA(&AS5600_hi2c, AS5600_DEV_ADDRESS, AS5600_REG_RAW_ANGLE, I2C_MEMADD_SIZE_8BIT,
-                    (uint8_t *)Encoder_Buff, 2);
-            if (status != HAL_OK) {
-                return 2;
-            }
+    } else if (SR1 & I2C_SR1_ADDR) {
+        (void) AS5600_I2C->SR2;     // Clear ADDR
+        if (RawAngleReadPhase == Register_ReadPhase) {
+            // Repeated START is generated after the register address is transmitted
+            AS5600_I2C->DR = AS5600_REG_RAW_ANGLE;
+            AS5600_I2C->CR1 |= I2C_CR1_START;
+            RawAngleReadPhase = Data_ReadPhase;
         } else {
-            return 3;
+            // 2 bytes are received by DMA, completion is handled in DMA interrupt
+            AS5600_I2C->CR2 &= ~I2C_CR2_ITEVTEN;
         }
     }
-    *pPosRes = PositionRes_buf;
-    return 0;
+    // BTF of register address is cleared by repeated START
+    return true;
 }
 
 /**
- * @brief       Set the present motor position response to the desired value
- * @param[in]   Position Desired position response
- * @param[in,out] pVelResInt Pointer of VelocityResInt, which is changed to avoid destabilization
+ * @brief       I2C error interrupt of periodic read
+ * @retval      true : Handled (HAL handler must not be called)
+ * @retval      false : Not related to periodic read
 */
-void setPositionResponse(float Position, float* pVelResInt)
+bool AS5600_I2C_ER_UserIRQHandler(void)
 {
-    AbsoluteCountSum_offset = AbsoluteCountSum - (int64_t) (Position / AbsoluteAngleCount2PositionRes);
-    *pVelResInt = Position;  // To avoid unstable
+    if (RawAngleReadPhase == Idle_ReadPhase)
+        return false;
+
+    if (AS5600_I2C->SR1 & I2C_SR1_AF)
+        ErrorStats.Nacks++;
+    else
+        ErrorStats.BusErrors++;
+    abortRawAngleRead();
+    hasError_I2C = true;
+    return true;
 }
 
-/***** Interrupt function prototypes *****/
 /**
- * @brief       When non-blocking mode memory read of AS5600 is completed, this function is called
- * @param[in,out] hi2c Pointer of I2C handler
+ * @brief       DMA interrupt of periodic read (when 2 bytes are received, the sample is stored)
+ * @retval      true : Handled (HAL handler must not be called)
+ * @retval      false : Not related to periodic read
 */
-void AS5600_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+bool AS5600_I2C_RxDMA_UserIRQHandler(void)
 {
-    AbsoluteAngleCount = (uint16_t) Encoder_Buff[0] << 8 | (uint16_t) Encoder_Buff[1];
-    AbsoluteAngleCount &= 0x0FFF;
-    updateRawAngleCount((uint16_t *) &AbsoluteAngleCount, (uint16_t*) &AbsoluteAngleCountPrev, (int64_t*) &AbsoluteCountSum);
+    if (RawAngleReadPhase != Data_ReadPhase)
+        return false;
+
+    uint32_t ISR = AS5600_DMA_ISR;
+    AS5600_DMA_IFCR = AS5600_DMA_FLAGS_ALL;
+    if (!(ISR & AS5600_DMA_FLAG_TC)) {
+        ErrorStats.DMAErrors++;
+        abortRawAngleRead();
+        hasError_I2C = true;
+        return true;
+    }
+    AS5600_I2C->CR1 |= I2C_CR1_STOP;
+    AS5600_I2C->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+
+    uint16_t Count = correctAngleCount(((uint16_t) Encoder_Buff[0] << 8 | (uint16_t) Encoder_Buff[1]) & 0x0FFF);
+#if USE_ENCODER_ANALOG_OUTPUT
+    if (isAnalogOutputValid) {
+        // Position response is updated by ADC interrupt, which preempts this one (AnalogAngleCount is read once)
+        AnalogDeviation = calcAngleDeviation(Count, AnalogAngleCount);
+        RawAngleReadPhase = Idle_ReadPhase;
+        return true;
+    }
+#endif
+    AbsoluteAngleCount = Count;
+    updateRawAngleCount((uint16_t *) &AbsoluteAngleCount, (uint16_t*) &AbsoluteAngleCountPrev, &AbsoluteCountSum);
+    storeCountSample(AbsoluteCountSum, ReadTimestamp);
+#if USE_ENCODER_ANALOG_OUTPUT
+    validateAnalogOutput(Count);
+#endif
+    RawAngleReadPhase = Idle_ReadPhase;
+    return true;
 }
 
+#if USE_ENCODER_ANALOG_OUTPUT
+/**
+ * @brief       When ADC1 conversion sequence is completed, this function is called with the count of AS5600 analog output
+ * @note        Called every PWM period before minor loop. Timestamp is taken here (constant delay from TIM3 update event).
+ *              While the analog output is not valid, the angle is only sampled for validation by I2C read.
+ * @param[in]   AdcCount ADC count of AS5600 OUT pin
+*/
+void AS5600_ADC_ConvCpltCallback(uint16_t AdcCount)
+{
+    uint32_t Timestamp = DWT->CYCCNT;
+
+    if ((AdcCount < AS5600_ANALOG_VALID_MIN) || (AdcCount > AS5600_ANALOG_VALID_MAX)) {
+        AnalogOutOfRangeCount++;
+        isAnalogOutputValid = false;    // I2C read is used for position response from the next sample
+        return;
+    }
+
+    int32_t Count = ((int32_t) AdcCount - AS5600_ANALOG_MIN_COUNT) * AS5600_RESOLUTION_PPR / AS5600_ANALOG_SPAN_COUNT;
+    if (Count < 0)
+        Count = 0;
+    else if (Count > AS5600_RESOLUTION_PPR - 1)
+        Count = AS5600_RESOLUTION_PPR - 1;
+    AnalogAngleCount = correctAngleCount((uint16_t) Count);
+    if (!isAnalogOutputValid)
+        return;
+    AbsoluteAngleCount = AnalogAngleCount;
+    updateRawAngleCount((uint16_t *) &AbsoluteAngleCount, (uint16_t*) &AbsoluteAngleCountPrev, &AbsoluteCountSum);
+    storeCountSample(AbsoluteCountSum, Timestamp);
+}
+#endif
+
 /**
  * @brief       When error is occured, this function is called
  * @param[in,out] hi2c Pointer of I2C handler
@@ -222,5 +656,216 @@ static inline void updateRawAngleCount(uint16_t* nowCount, uint16_t* prevCount,
     *prevCount = *nowCount;
 }
 
+/**
+ * @brief       Start periodic read of raw angle (register 0x0C, repeated START, 2 bytes)
+ * @note        Called only when no read is in progress.
+ * @retval      true : Started
+ * @retval      false : Bus is busy
+*/
+static inline bool startRawAngleRead(void)
+{
+    if (AS5600_I2C->SR2 & I2C_SR2_BUSY)
+        return false;   // Bus is held by the slave (detected as timeout)
+
+    // DMA stream is enabled before START, I2C issues the requests after the address (read) is acknowledged
+    AS5600_DMA_IFCR = AS5600_DMA_FLAGS_ALL;
+    AS5600_DMA_STREAM->PAR = (uint32_t) &AS5600_I2C->DR;
+    AS5600_DMA_STREAM->M0AR = (uint32_t) Encoder_Buff;
+    AS5600_DMA_STREAM->NDTR = 2;
+    AS5600_DMA_STREAM->CR = (AS5600_DMA_STREAM->CR & ~DMA_SxCR_HTIE) | DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_EN;
+
+    RawAngleReadPhase = Register_ReadPhase;
+    AS5600_I2C->CR2 = (AS5600_I2C->CR2 & ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN)) | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+    AS5600_I2C->CR1 |= I2C_CR1_ACK | I2C_CR1_START;
+    return true;
+}
+
+/**
+ * @brief       Abort periodic read (bus is recovered by the following sampling periods)
+*/
+static inline void abortRawAngleRead(void)
+{
+    AS5600_I2C->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+    AS5600_DMA_STREAM->CR &= ~(DMA_SxCR_EN | DMA_SxCR_TCIE | DMA_SxCR_TEIE);
+    AS5600_DMA_IFCR = AS5600_DMA_FLAGS_ALL;
+    AS5600_I2C->SR1 = ~AS5600_I2C_ERROR_FLAGS & 0xFFFF;   // Error flags are cleared by writing 0
+    AS5600_I2C->CR1 |= I2C_CR1_STOP;
+    RawAngleReadPhase = Idle_ReadPhase;
+}
+
+/**
+ * @brief       Execute one step of bus recovery (called every sampling period while hasError_I2C is set)
+ * @details     I2C peripheral is disabled while SCL and SDA are driven by GPIO (one edge per period),
+ *              then it is reset and configured again (BUSY flag latched by a glitch is also cleared).
+*/
+static inline void recoverBus(void)
+{
+    if (RecoveryStep == 0) {
+        ErrorStats.Recoveries++;
+        AS5600_I2C->CR1 &= ~I2C_CR1_PE;
+    }
+    if (!AS5600_I2C_RecoverBusStep(&RecoveryStep))
+        return;
+
+    AS5600_I2C->CR1 |= I2C_CR1_SWRST;
+    AS5600_I2C->CR1 &= ~I2C_CR1_SWRST;
+    HAL_I2C_Init(&AS5600_hi2c);     // Registers only (does not block, MSP is not initialized again)
+    hasError_I2C = false;
+}
+
+/**
+ * @brief       Update health by the number of sampling periods without a new sample
+*/
+static inline void updateEncoderHealth(void)
+{
+    static uint32_t HeadPrev = 0;
+    uint32_t Head = SampleHead;
+    EncoderHealth NewHealth;
+
+    if (Head != HeadPrev) {
+        HeadPrev = Head;
+        ErrorStats.MissedSamples = 0;
+        NewHealth = Healthy_EncoderHealth;
+    } else {
+        if (++ErrorStats.MissedSamples > ErrorStats.MaxMissedSamples)
+            ErrorStats.MaxMissedSamples = ErrorStats.MissedSamples;
+        NewHealth = (ErrorStats.MissedSamples >= AS5600_FAULT_MISSED_SAMPLES) ? Fault_EncoderHealth : Holding_EncoderHealth;
+    }
+
+    if (NewHealth != Health) {
+        if (NewHealth == Fault_EncoderHealth) {
+            ErrorStats.Faults++;
+            HAL_GPIO_WritePin(EncErr_GPIO_Port, EncErr_Pin, GPIO_PIN_SET);
+        } else if (Health == Fault_EncoderHealth) {
+            HAL_GPIO_WritePin(EncErr_GPIO_Port, EncErr_Pin, GPIO_PIN_RESET);
+        }
+        Health = NewHealth;
+    }
+}
+
+/**
+ * @brief       Correct raw angle by the table (position response is the negative of the angle)
+ * @param[in]   Count Raw angle [count]
+ * @return      Corrected angle [count]
+*/
+static inline uint16_t correctAngleCount(uint16_t Count)
+{
+    const int8_t* pTable = CorrectionTable;
+    if (pTable)
+        Count = (uint16_t) (Count - pTable[Count]) & (AS5600_RESOLUTION_PPR - 1);
+    return Count;
+}
+
+/**
+ * @brief       Calculate CRC of correction table
+ * @details     CRC-32 (polynomial 0x04C11DB7, reflected, same as Ethernet and zlib) of Size (little endian) and the table,
+ *              calculated by 4-bit lookup.
+ * @param[in]   pTable Correction table
+ * @return      CRC-32 of size and the table
+*/
+static inline uint32_t calcCorrectionCRC(const int8_t* pTable)
+{
+    static const uint32_t Table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint32_t Size = AS5600_RESOLUTION_PPR;
+    uint32_t Crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < sizeof(Size) + AS5600_RESOLUTION_PPR; i++) {
+        uint8_t Byte = (i < sizeof(Size)) ? (uint8_t) (Size >> (8 * i)) : (uint8_t) pTable[i - sizeof(Size)];
+        Crc = (Crc >> 4) ^ Table[(Crc ^ Byte) & 0x0F];
+        Crc = (Crc >> 4) ^ Table[(Crc ^ (Byte >> 4)) & 0x0F];
+    }
+    return ~Crc;
+}
+
+/**
+ * @brief       Store a sample to ring buffer (writer context only)
+ * @param[in]   CountSum Multi-turn count
+ * @param[in]   Timestamp DWT cycle counter when the read was started
+*/
+static inline void storeCountSample(int64_t CountSum, uint32_t Timestamp)
+{
+    uint32_t Head = SampleHead;
+    CountSample* pSample = &SampleBuffer[Head & (AS5600_SAMPLE_BUFFER_SIZE - 1)];
+    pSample->CountSum = CountSum;
+    pSample->Timestamp = Timestamp;
+    __DMB();    // Sample is written before it is published
+    SampleHead = Head + 1;
+}
+
+/**
+ * @brief       Load a sample from ring buffer (any context)
+ * @note        The copy is retried if the writer has reached the slot during the copy.
+ * @param[out]  pSample Pointer of sample
+ * @param[in]   Depth 0 : latest sample, n : n-th sample before the latest one
+ * @retval      0 Success to load
+ * @retval      -1 The sample is not available
+*/
+static inline int loadCountSample(CountSample* pSample, uint32_t Depth)
+{
+    uint32_t Head;
+
+    if (Depth >= AS5600_SAMPLE_BUFFER_SIZE - 1)
+        return -1;
+    do {
+        Head = SampleHead;
+        if (Head <= Depth)
+            return -1;
+        __DMB();
+        *pSample = SampleBuffer[(Head - 1 - Depth) & (AS5600_SAMPLE_BUFFER_SIZE - 1)];
+        __DMB();
+    } while ((SampleHead - Head) >= AS5600_SAMPLE_BUFFER_SIZE - 1 - Depth);
+    return 0;
+}
+
+
+#if USE_ENCODER_ANALOG_OUTPUT
+/**
+ * @brief       Calculate deviation between two raw angles (wrapped to half revolution)
+ * @param[in]   Count Raw angle [count]
+ * @param[in]   RefCount Reference raw angle [count]
+ * @return      Count - RefCount (-AS5600_RESOLUTION_PPR/2 ~ AS5600_RESOLUTION_PPR/2) [count]
+*/
+static inline int16_t calcAngleDeviation(uint16_t Count, uint16_t RefCount)
+{
+    int16_t Deviation = (int16_t) Count - (int16_t) RefCount;
+    if (Deviation > AS5600_RESOLUTION_PPR / 2)
+        Deviation -= AS5600_RESOLUTION_PPR;
+    else if (Deviation < -AS5600_RESOLUTION_PPR / 2)
+        Deviation += AS5600_RESOLUTION_PPR;
+    return Deviation;
+}
+
+/**
+ * @brief       Validate analog output by I2C read (called after each I2C sample while the analog output is not valid)
+ * @details     The analog output is used again after AS5600_ANALOG_VALIDATE_SAMPLES consecutive I2C reads agree with it
+ *              within AS5600_ANALOG_AGREE_COUNT and no analog sample is out of range in the meantime.
+ *              The multi-turn count has been updated by this I2C read, so ADC interrupt continues from it.
+ * @param[in]   Count Corrected raw angle of I2C read [count]
+*/
+static inline void validateAnalogOutput(uint16_t Count)
+{
+    static uint32_t AgreedSamples = 0;
+    static uint32_t OutOfRangeCountPrev = 0;
+    uint32_t OutOfRangeCount = AnalogOutOfRangeCount;
+    int16_t Deviation = calcAngleDeviation(Count, AnalogAngleCount);
+
+    if ((OutOfRangeCount != OutOfRangeCountPrev)
+            || (Deviation > AS5600_ANALOG_AGREE_COUNT) || (Deviation < -AS5600_ANALOG_AGREE_COUNT)) {
+        OutOfRangeCountPrev = OutOfRangeCount;
+        AgreedSamples = 0;
+        return;
+    }
+    if (++AgreedSamples < AS5600_ANALOG_VALIDATE_SAMPLES)
+        return;
+
+    AgreedSamples = 0;
+    AnalogDeviation = Deviation;
+    __DMB();    // Multi-turn count is written before ADC interrupt takes it over
+    isAnalogOutputValid = true;
+}
+#endif
 
 /***************************************************************END OF FILE****/
@@ -55,14 +55,15 @@
 
 /* USER CODE BEGIN 0 */
 #include <stdint.h>
+#include "control.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "RotaryEncoder_AS5600.h"
 
-/**************** System parameters ***************/
-#define ADC_RESOLUTION      4096    // 12-bit
-#define ADC_VCC             3.3f    // [V]          Supply voltage of ADC
-
-volatile uint16_t ADC1Value[5];
-volatile float CurrentPinVoltage;
+volatile uint16_t ADC1Value[ADC1_NUM_CONVERSIONS];
 volatile float Param1, Param2, Param3, Param4;
+
+static SNAPSHOT(ADC1Data) ADC1Snapshot;   // Consistent set of ADC1 values of the latest sequence
 /* USER CODE END 0 */
 
 ADC_HandleTypeDef hadc1;
@@ -84,7 +85,7 @@ void MX_ADC1_Init(void)
   hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
   hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T3_TRGO;
   hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;
-  hadc1.Init.NbrOfConversion = 5;
+  hadc1.Init.NbrOfConversion = ADC1_NUM_CONVERSIONS;
   hadc1.Init.DMAContinuousRequests = ENABLE;
   hadc1.Init.EOCSelection = ADC_EOC_SEQ_CONV;
   if (HAL_ADC_Init(&hadc1) != HAL_OK)
@@ -139,6 +140,18 @@ void MX_ADC1_Init(void)
     _Error_Handler(__FILE__, __LINE__);
   }
 
+#if USE_ENCODER_ANALOG_OUTPUT
+    /**AS5600 analog output (sampled in the same sequence as current response)
+    * PC0 (Arduino A5) must be wired to CN_AS5600 pin 6 (OUT) by a jumper wire
+    */
+  sConfig.Channel = ADC_CHANNEL_10;
+  sConfig.Rank = 6;
+  if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
+  {
+    _Error_Handler(__FILE__, __LINE__);
+  }
+#endif
+
 }
 
 void HAL_ADC_MspInit(ADC_HandleTypeDef* adcHandle)
@@ -198,6 +211,14 @@ void HAL_ADC_MspInit(ADC_HandleTypeDef* adcHandle)
     HAL_NVIC_SetPriority(ADC_IRQn, 5, 0);
     HAL_NVIC_EnableIRQ(ADC_IRQn);
   /* USER CODE BEGIN ADC1_MspInit 1 */
+#if USE_ENCODER_ANALOG_OUTPUT
+    /**PC0     ------> ADC1_IN10 (AS5600 OUT)
+    */
+    GPIO_InitStruct.Pin = EncOut_Pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(EncOut_GPIO_Port, &GPIO_InitStruct);
+#endif
 
   /* USER CODE END ADC1_MspInit 1 */
   }
@@ -248,12 +269,39 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc)
 
 void ADC1_ConvCpltCallback(ADC_HandleTypeDef* hadc)
 {
+#if !USE_FIXED_POINT_CONTROL
     static const float inv_ADCresolution = 1.0f / (float)ADC_RESOLUTION;
-    CurrentPinVoltage = (float) ADC1Value[0] * inv_ADCresolution * ADC_VCC;
-    Param1 = (float) ADC1Value[1] * inv_ADCresolution;
-    Param2 = (float) ADC1Value[2] * inv_ADCresolution;
-    Param3 = (float) ADC1Value[3] * inv_ADCresolution;
-    Param4 = (float) ADC1Value[4] * inv_ADCresolution;
+#endif
+    ADC1Data data;
+    PROFILER_BEGIN(ADC1_ConvCpltCallback_Profile);
+    data.CurrentPinCount = ADC1Value[0];
+#if !USE_FIXED_POINT_CONTROL
+    // Fixed-point control uses raw counts only
+    data.CurrentPinVoltage = (float) ADC1Value[0] * inv_ADCresolution * ADC_VCC;
+    data.Param1 = Param1 = (float) ADC1Value[1] * inv_ADCresolution;
+    data.Param2 = Param2 = (float) ADC1Value[2] * inv_ADCresolution;
+    data.Param3 = Param3 = (float) ADC1Value[3] * inv_ADCresolution;
+    data.Param4 = Param4 = (float) ADC1Value[4] * inv_ADCresolution;
+#endif
+#if USE_ENCODER_ANALOG_OUTPUT
+    data.EncoderPinCount = ADC1Value[5];
+    AS5600_ADC_ConvCpltCallback(ADC1Value[5]);  // Position response before minor loop
+#endif
+    writeSnapshot(&ADC1Snapshot, data);
+
+#if USE_ISR_MINOR_LOOP
+    MinorLoopISR();
+#endif
+    PROFILER_END(ADC1_ConvCpltCallback_Profile);
+}
+
+/**
+ * @brief  Read a consistent set of ADC1 values of the latest conversion sequence
+ * @param  pData Pointer to store ADC1 values
+ */
+void readADC1Data(ADC1Data* pData)
+{
+    readSnapshot(&ADC1Snapshot, pData);
 }
 /* USER CODE END 1 */
 
@@ -0,0 +1,123 @@
+/**
+ ******************************************************************************
+ * @file    arm_math_compat.c
+ * @brief   Source file of CMSIS-DSP compatible functions
+ * @details The CMSIS-DSP library binary is not included in this project,
+ *          so the library functions used by control_kernel.c are implemented here with the same interface and behavior.
+ *          Set USE_CMSIS_DSP_LIBRARY to 1 and link libarm_cortexM4lf_math.a to use the library instead.
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "control_kernel.h"
+
+#if !USE_CMSIS_DSP_LIBRARY
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialization function for the floating-point PID Control
+ * @param[in,out] S Pointer of PID instance
+ * @param[in]   resetStateFlag 0 : no change in state, 1 : reset the state
+*/
+void arm_pid_init_f32(arm_pid_instance_f32* S, int32_t resetStateFlag)
+{
+    S->A0 = S->Kp + S->Ki + S->Kd;
+    S->A1 = (-S->Kp) - ((float32_t) 2.0 * S->Kd);
+    S->A2 = S->Kd;
+
+    if (resetStateFlag) {
+        memset(S->state, 0, 3u * sizeof(float32_t));
+    }
+}
+
+/**
+ * @brief       Reset function for the floating-point PID Control
+ * @param[in,out] S Pointer of PID instance
+*/
+void arm_pid_reset_f32(arm_pid_instance_f32* S)
+{
+    memset(S->state, 0, 3u * sizeof(float32_t));
+}
+
+/**
+ * @brief       Initialization function for the floating-point Biquad cascade filter
+ * @param[in,out] S Pointer of filter instance
+ * @param[in]   numStages Number of 2nd order stages
+ * @param[in]   pCoeffs Pointer of coefficients {b0, b1, b2, a1, a2} x numStages
+ * @param[in]   pState Pointer of state buffer (length : 4 * numStages)
+*/
+void arm_biquad_cascade_df1_init_f32(arm_biquad_casd_df1_inst_f32* S, uint8_t numStages,
+        float32_t* pCoeffs, float32_t* pState)
+{
+    S->numStages = numStages;
+    S->pCoeffs = pCoeffs;
+    memset(pState, 0, 4u * (uint32_t) numStages * sizeof(float32_t));
+    S->pState = pState;
+}
+
+/**
+ * @brief       Processing function for the floating-point Biquad cascade filter
+ * @details     y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] + a1*y[n-1] + a2*y[n-2] for each stage
+ * @param[in]   S Pointer of filter instance
+ * @param[in]   pSrc Pointer of input block
+ * @param[out]  pDst Pointer of output block
+ * @param[in]   blockSize Number of samples
+*/
+void arm_biquad_cascade_df1_f32(const arm_biquad_casd_df1_inst_f32* S,
+        float32_t* pSrc, float32_t* pDst, uint32_t blockSize)
+{
+    float32_t* pIn = pSrc;
+    float32_t* pState = S->pState;
+    const float32_t* pCoeffs = S->pCoeffs;
+    uint32_t stage = S->numStages;
+
+    do {
+        const float32_t b0 = pCoeffs[0], b1 = pCoeffs[1], b2 = pCoeffs[2];
+        const float32_t a1 = pCoeffs[3], a2 = pCoeffs[4];
+        float32_t Xn1 = pState[0], Xn2 = pState[1];
+        float32_t Yn1 = pState[2], Yn2 = pState[3];
+        float32_t* pOut = pDst;
+
+        for (uint32_t n = 0; n < blockSize; n++) {
+            float32_t Xn = *pIn++;
+            float32_t acc = (b0 * Xn) + (b1 * Xn1) + (b2 * Xn2) + (a1 * Yn1) + (a2 * Yn2);
+            Xn2 = Xn1;
+            Xn1 = Xn;
+            Yn2 = Yn1;
+            Yn1 = acc;
+            *pOut++ = acc;
+        }
+
+        pState[0] = Xn1;
+        pState[1] = Xn2;
+        pState[2] = Yn1;
+        pState[3] = Yn2;
+        pState += 4;
+        pCoeffs += 5;
+
+        // Output of this stage is input of the next stage
+        pIn = pDst;
+    } while (--stage > 0u);
+}
+
+/* Private functions ---------------------------------------------------------*/
+#endif /* !USE_CMSIS_DSP_LIBRARY */
+/***************************************************************END OF FILE****/
@@ -26,7 +26,7 @@
  *  - static void MinorControlLoop(void)\n
  *    Minor control loop function (Period : 50[us])\n
  *    \n
- *  - static void PositionControl(float PosCmd, float VelCmd, float P_Gain, float I_Gain, float D_Gain)\n\n
+ *  - static void PositionControl(float PosCmd, float VelCmd, float AccCmd, float P_Gain, float I_Gain, float D_Gain)\n\n
  *  - static void VelocityControl(float VelCmd, float P_Gain, float I_Gain)\n\n
  *  - static void TorqueControl(float Command)\n\n
  *  - static void configCurrentControl(bool isEnabled, float P_Gain, float I_Gain)\n
@@ -51,51 +51,212 @@
 #include "CurrentSenseAmp_INA181.h"
 #include "RotaryEncoder_AS5600.h"
 #include "MotorDriver_TB6612.h"
-//#include "DOB.h" // Disturbance observer (Not implemented)
+#include "usart.h"
+#include "tim.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "control_kernel.h"
+#include "controller.h"
+#include "trajectory.h"
+#include "motion_planner.h"
+#include "DOB.h"
+#include "velocity_estimator.h"
+#include "kalman_filter.h"
+#include "frequency_response.h"
+#include "relay_autotune.h"
+#include "encoder_calibration.h"
+#if USE_FIXED_POINT_CONTROL
+#include "control_fixed.h"
+#endif
 
 // FreeRTOS
 #include "FreeRTOS.h"
 #include "task.h"
+#include "cmsis_os.h"
 
 /* Imported variables --------------------------------------------------------*/
 extern ADC_HandleTypeDef hadc1;
+extern osThreadId MajorLoopControlHandle;
 
 /* Private function macro ----------------------------------------------------*/
 #define enableControl()  (isEnabled_Control = true)
 #define disableControl() (isEnabled_Control = false)
 
 /* Private macro -------------------------------------------------------------*/
-#ifndef M_PI
-#define M_PI 3.14159265358979323846f
+#if USE_FIXED_POINT_CONTROL && USE_DISTURBANCE_OBSERVER
+#error Disturbance observer is not supported by fixed-point control
+#endif
+#if USE_FIXED_POINT_CONTROL && USE_DEADBEAT_CURRENT_CONTROL
+#error Deadbeat current control is not supported by fixed-point control
+#endif
+#if USE_FIXED_POINT_CONTROL && USE_FREQUENCY_RESPONSE_ANALYZER
+#error Frequency response analyzer is not supported by fixed-point control
+#endif
+#if (USE_FIXED_POINT_CONTROL || USE_CONSTANT_GAINS) && USE_AUTO_TUNING
+#error Auto-tuning needs floating-point controllers with runtime gains
+#endif
+#if USE_FIXED_POINT_CONTROL && USE_ENCODER_CALIBRATION
+#error Encoder calibration is not supported by fixed-point control
+#endif
+#if USE_FIXED_POINT_CONTROL && USE_REACTION_TORQUE_OBSERVER
+#error Reaction torque observer is not supported by fixed-point control
+#endif
+#if USE_FIXED_POINT_CONTROL && USE_MOTION_PLANNER
+#error Motion planner is not supported by fixed-point control (use the trajectory source in counts)
 #endif
 
 /* Private types -------------------------------------------------------------*/
 /* Private enum tag ----------------------------------------------------------*/
 /**
- * @enum ControlMode
- * Control mode
+ * @enum ControlModeType
+ * Control mode (changed only by changeControlMode)
  */
-static enum
+typedef enum
 {
     None_ControlMode = 0,   ///< None (default)
     PositionControlMode,    ///< Position control
     VelocityControlMode,    ///< Velocity control
-    TorqueControlMode       ///< Torque control
-} ControlMode = None_ControlMode;
+    TorqueControlMode,      ///< Torque control
+    AutoTuneControlMode,    ///< Relay feedback auto-tuning (USE_AUTO_TUNING)
+    EncoderCalibControlMode ///< Velocity control at constant velocity for encoder calibration (USE_ENCODER_CALIBRATION)
+} ControlModeType;
+
+/**
+ * @enum InjectionPointType
+ * Injection point of frequency response analysis
+ */
+typedef enum
+{
+    Voltage_InjectionPoint = 0,         ///< Voltage reference (minor loop)
+    CurrentCommand_InjectionPoint,      ///< Current command (major loop)
+    AccelerationReference_InjectionPoint, ///< Acceleration reference (major loop)
+    NumInjectionPoints
+} InjectionPointType;
+
+/**
+ * @enum AutoTunePhaseType
+ * Phase of auto-tuning (the phase where it stopped if failed)
+ */
+typedef enum
+{
+    Current_AutoTunePhase = 0,  ///< Relay on voltage reference, current response
+    Velocity_AutoTunePhase,     ///< Relay on acceleration reference, velocity response
+    Position_AutoTunePhase,     ///< Relay on acceleration reference with velocity feedback, position response
+    Finished_AutoTunePhase,     ///< All gains have been applied
+    NumAutoTunePhases
+} AutoTunePhaseType;
 
 /* Private struct/union tag --------------------------------------------------*/
+/**
+ * @struct CurrentLoopCommand
+ * Values handed from major loop to minor loop
+ */
+typedef struct
+{
+#if USE_FIXED_POINT_CONTROL
+    int32_t CurrentCmd;         ///< Current command [count]
+    int32_t VelocityRes;        ///< Velocity response for back-EMF feedforward [count/s]
+    FixedGains CurrentGains;    ///< Current control gains [pulse/count]
+    int32_t ResistanceGain;     ///< Nominal resistance [pulse/count]
+    int32_t BackEMFGain;        ///< Nominal back-EMF constant [pulse/(count/s)]
+#else
+    float CurrentCmd;           ///< Current command [A]
+    float VelocityRes;          ///< Velocity response for back-EMF feedforward [rad/s]
+    PICoeffs CurrentCoeffs;     ///< Current control coefficients
+#endif
+    bool isEnabled;             ///< Enable or disable current control
+    uint32_t ResetCount;        ///< Minor loop variables are reset when this value is changed
+} CurrentLoopCommand;
+
+/**
+ * @struct CurrentLoopResponse
+ * Values handed from minor loop to major loop
+ */
+typedef struct
+{
+#if USE_FIXED_POINT_CONTROL
+    int32_t CurrentRes;         ///< Current response [count]
+    int32_t VoltageRef;         ///< Voltage reference [PWM compare value]
+#else
+    float CurrentRes;           ///< Current response [A]
+    float VoltageRef;           ///< Voltage reference [V]
+#endif
+    int Saturation;             ///< Saturation of voltage reference (1 : upper limit, -1 : lower limit, 0 : not saturated)
+} CurrentLoopResponse;
+
+/**
+ * @struct MonitorData
+ * Values handed from major loop to serial communication task
+ */
+typedef struct
+{
+#if USE_FIXED_POINT_CONTROL
+    int32_t PositionCmd, PositionRes;   ///< [count] (converted into physical units by serial communication task)
+    int32_t VelocityCmd, VelocityRes;   ///< [count/s]
+#else
+    float PositionCmd, PositionRes;
+    float VelocityCmd, VelocityRes;
+    float LoadTorque;
+#endif
+} MonitorData;
+
 /* Private variables ---------------------------------------------------------*/
 // Variables for motion control
-static bool isEnabled_Control = true;
+static ControlModeType ControlMode = None_ControlMode;
+static volatile bool isEnabled_Control = true;
 static bool isEnabled_CurrentControl = true;
-static bool hasDiverged = false;
-static float time_sec;
-static float PositionCmd, PositionRes, PositionErr, PositionErrInt;
-static float VelocityCmd, VelocityRes, VelocityErr, VelocityErrInt, VelocityResInt;
+static volatile bool hasDiverged = false;
+static uint32_t ElapsedMajorTicks = 0;   // Major loop periods since previous MajorControlLoop
+static float PositionCmd, PositionRes, PositionErr;
+static float VelocityCmd, VelocityRes, VelocityErr;
 static float TorqueCmd;
-static float AccelerationRef, CurrentRef;
-static float CurrentCmd, CurrentRes, CurrentErr, CurrentErrInt;
-static float VoltageRef;
+static float AccelerationCmd, AccelerationRef, CurrentRef;
+static float CurrentCmd;                            // Major loop
+static float CurrentRes, CurrentErr;                // Minor loop
+static float VoltageRef;                            // Minor loop
+static float LoadTorque;                            // Major loop
+
+// Snapshots handed between contexts
+static SNAPSHOT(CurrentLoopCommand)  CurrentLoopCmdSnapshot;  // Major loop -> Minor loop
+static SNAPSHOT(CurrentLoopResponse) CurrentLoopResSnapshot;  // Minor loop -> Major loop
+static SNAPSHOT(MonitorData)         MonitorSnapshot;         // Major loop -> Serial communication task
+static uint32_t CurrentLoopResetCount = 0;
+static CurrentLoopResponse InnerRes;    // Major loop (CurrentLoopResSnapshot is read once per period)
+
+static float PositionPerCount;                      // Resolution of position response [rad/count]
+
+#if USE_FIXED_POINT_CONTROL
+// Variables for fixed-point control (unit : encoder count, ADC count and PWM compare value)
+static float CurrentPerCount, PulsePerVoltage;
+static int32_t MaxPulse;
+static int32_t PositionCmdCount, PositionResCount, PositionErrIntCount;
+static int32_t VelocityCmdCount, VelocityResCount, VelocityErrIntCount;
+static int32_t AccelerationCmdCount;
+static int32_t TorqueCmdCount;
+static int32_t CurrentCmdCount;                     // Major loop
+static int32_t CurrentErrIntCount;                  // Minor loop
+static FixedPseudoDifferential VelocityPD;
+static FixedGains PositionGains, VelocityGains;
+static FixedGains CurrentGains;
+static int32_t ResistanceGain, BackEMFGain;
+static int32_t AccelerationGain;                    // Nominal inertia [current count/(count/s^2)]
+#endif
+
+#if !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_MT)
+static MTEstimator VelocityEstimator;                   // Major loop
+#elif !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_PLL)
+static PLLEstimator VelocityEstimator;                  // Major loop
+#elif !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_KALMAN)
+static const KalmanCoeffs StateEstimatorCoeffs = KALMAN_COEFFS(Mn, Ktn, dt_major, Lkf_p_DEFAULT, Lkf_v_DEFAULT, Lkf_d_DEFAULT);
+static KalmanFilter StateEstimator;                     // Major loop
+#endif
+
+#if USE_CMSIS_DSP_CONTROL
+// Controller and filter kernels (CMSIS-DSP)
+static arm_pid_instance_f32 PositionPID, VelocityPID;   // Major loop
+static BiquadKernel VelocityFilter;                     // Major loop
+static arm_pid_instance_f32 CurrentPID;                 // Minor loop
+#endif
 
 // Gain
 static float Kp_p = Kp_p_DEFAULT, Ki_p = Ki_p_DEFAULT, Kd_p = Kd_p_DEFAULT;
@@ -103,56 +264,305 @@ static float Kp_v = Kp_v_DEFAULT, Ki_v = Ki_v_DEFAULT;
 static float Kp_c = Kp_c_DEFAULT, Ki_c = Ki_c_DEFAULT;
 static float Gpd  = Gpd_DEFAULT;
 
+// Controller coefficients and state (controller.h)
+#if USE_CONSTANT_GAINS
+static const PIDCoeffs PositionCoeffs = PID_COEFFS(Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT, dt_major);
+static const PICoeffs VelocityCoeffs = PI_COEFFS(Kp_v_DEFAULT, Ki_v_DEFAULT, dt_major);
+static const PICoeffs CurrentCoeffs = PI_COEFFS(Kp_c_DEFAULT, Ki_c_DEFAULT, dt_minor);
+static const PseudoDiffCoeffs VelocityResCoeffs = PSEUDO_DIFF_COEFFS(Gpd_DEFAULT, dt_major);
+static const DOBCoeffs DisturbanceCoeffs = DOB_COEFFS(Gdob_DEFAULT, Mn, Ktn, dt_major);
+#else
+static PIDCoeffs PositionCoeffs = PID_COEFFS(Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT, dt_major);
+static PICoeffs VelocityCoeffs = PI_COEFFS(Kp_v_DEFAULT, Ki_v_DEFAULT, dt_major);
+static PICoeffs CurrentCoeffs = PI_COEFFS(Kp_c_DEFAULT, Ki_c_DEFAULT, dt_minor);
+static PseudoDiffCoeffs VelocityResCoeffs = PSEUDO_DIFF_COEFFS(Gpd_DEFAULT, dt_major);
+static DOBCoeffs DisturbanceCoeffs = DOB_COEFFS(Gdob_DEFAULT, Mn, Ktn, dt_major);
+#endif
+static ControllerState PositionState, VelocityState, VelocityResState;  // Major loop
+static DOBState DisturbanceState;                                       // Major loop
+
+// Reaction torque observer (friction model is not tuned at runtime)
+static const RTOBCoeffs LoadTorqueCoeffs = RTOB_COEFFS(Grtob_DEFAULT, Mn, Ktn, Fcn, Dvn, FRICTION_VELOCITY_BAND, dt_major);
+static DOBState LoadTorqueState;                                        // Major loop
+static ControllerState CurrentState;                                    // Minor loop
+#if USE_DEADBEAT_CURRENT_CONTROL
+static const DeadbeatCoeffs CurrentDeadbeatCoeffs = DEADBEAT_COEFFS(Rn, Ln, dt_minor, Kdb_c_DEFAULT, Vm);
+#endif
+
 static bool isSvonSwOn = false, isSvonSwOn_prev = false;
 static bool isSysBtnPushed = false, isSysBtnPushed_prev = false;
 
 static bool needsOutputInfo = false;
+#if USE_REACTION_TORQUE_OBSERVER
+static bool needsOutputLoadTorque = false;
+#endif
+
+#if USE_AUTO_TUNING
+// Auto-tuning (started by Sys push button, result is output by serial communication task)
+static RelayExperiment CurrentRelay;                    // Minor loop
+static RelayExperiment MotionRelay;                     // Major loop
+static AutoTunePhaseType AutoTunePhase = Current_AutoTunePhase;
+static float AutoTunePositionCmd;
+static volatile bool needsOutputAutoTuning = false;
+static const char* const AutoTunePhaseNames[NumAutoTunePhases] = {
+    "Current", "Velocity", "Position", "Finished"
+};
+#endif
+
+#if USE_ENCODER_CALIBRATION
+// Encoder calibration (requested by serial communication task, executed by major loop task and written to flash by serial communication task)
+static EncoderCalibration EncoderCalib;                 // Major loop
+static int8_t EncoderCorrection[ENCODER_CORRECTION_TABLE_SIZE];
+static volatile bool needsToggleEncoderCalibration = false;
+static volatile bool needsWriteEncoderCorrection = false;   // Major loop -> Serial communication task
+static volatile bool needsOutputEncoderCalibration = false;
+static volatile bool isEncoderCorrectionWritten = false;
+#endif
+
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+// Frequency response analysis (started by serial communication task, executed by the loop of the injection point)
+static FRA Analyzer;
+static volatile InjectionPointType InjectionPoint = CurrentCommand_InjectionPoint;
+static const char* const InjectionPointNames[NumInjectionPoints] = {
+    "Voltage", "CurrentCommand", "AccelerationReference"
+};
+#endif
+
+// Deadline miss
+static volatile DeadlineMissCount MissCount;
+static bool needsSkipMinorLoop = false;
+static volatile bool isQuiesced = false;    // Loops are stopped (e.g. flash write), deadline misses are not counted
+
+// Command source (1[Hz] sine, pause, step with period 2.5[s])
+static const TrajectorySegment DemoSegments[] = {
+    TRAJECTORY_SINE(SEC_TO_TICKS(1.0f, dt_major), 0.0f, 1.0f, 1.0f),
+    TRAJECTORY_HOLD(SEC_TO_TICKS(0.5f, dt_major), 0.0f),
+    TRAJECTORY_HOLD(SEC_TO_TICKS(0.5f, dt_major), 1.0f),
+    TRAJECTORY_HOLD(SEC_TO_TICKS(0.5f, dt_major), 0.0f),
+};
+#if USE_FIXED_POINT_CONTROL
+static TrajectoryCountSource DemoTrajectory;
+#else
+static TrajectorySource DemoTrajectory;
+#endif
+
+#if USE_MOTION_PLANNER
+// Point-to-point demo (moves are planned by serial communication task and executed by major loop)
+#define DEMO_MOVE_DISTANCE      (2.0f * 3.14159265f)    ///< Target position of forward move (one revolution) [rad]
+#define DEMO_MOVE_VELOCITY      20.0f                   ///< [rad/s]
+#define DEMO_MOVE_ACCELERATION  400.0f                  ///< [rad/s^2]
+#define DEMO_MOVE_JERK          20000.0f                ///< [rad/s^3]
+#define DEMO_MOVE_DWELL         0.5f                    ///< [s]
+static MotionPlanner Planner;
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
 // Control variables
 static void resetControlVariables(void);
+static inline void resetPositionResponse(void);
 
 // Control loop
 static inline void MajorControlLoop(void);
 static inline void MinorControlLoop(void);
 
 // Control
-static inline void PositionControl(float, float, float, float, float);
+static inline void PositionControl(float, float, float, float, float, float);
+#if USE_FIXED_POINT_CONTROL
+static inline void PositionControlCount(int32_t, int32_t, int32_t);
+#endif
 static inline void VelocityControl(float, float, float);
 static inline void TorqueControl(float);
+static inline void changeControlMode(ControlModeType);
+static inline void setPositionGains(float, float, float);
+static inline void setVelocityGains(float, float);
 
 static inline void configCurrentControl(bool, float, float);
+static inline void publishCurrentLoopCommand(void);
 static inline bool validateDivergence(void);
+static inline bool handleDeadlineMiss(uint32_t, volatile uint32_t*, int);
+#if USE_AUTO_TUNING
+static inline float calcAutoTuning(void);
+#endif
+#if USE_ENCODER_CALIBRATION
+static inline void finishEncoderCalibration(void);
+static inline void resumeFromEncoderCalibration(void);
+#endif
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+static inline void startFrequencyResponseAnalysis(FRAExcitation);
+static inline void outputFrequencyResponse(void);
+#endif
+#if USE_MOTION_PLANNER
+static inline void enqueueDemoMoves(void);
+#endif
 
 /* Exported functions --------------------------------------------------------*/
 /**
  * @brief       Low priority task that communicates with UART
+ * @details     One-character commands from PC
+ *              - 'p' : Output loop profile (execution time and jitter)
+ *              - 'r' : Reset loop profile
+ *              - 'd' : Output number of missed deadlines
+ *              - 'k' : Output benchmark of controller and filter kernels
+ *              - 'e' : Output health and error statistics of encoder
+ *              - 't' : Toggle output of estimated load torque [mNm] (appended to continuous output, USE_REACTION_TORQUE_OBSERVER)
+ *              - 'i' : Change injection point of frequency response analysis
+ *              - 'f' : Start (or stop) frequency response analysis with swept sine
+ *              - 'n' : Start (or stop) frequency response analysis with PRBS
+ *              - 'c' : Start (or abort) encoder calibration, the correction table is written to flash by this task when finished
  * @param       argument Task parameters
 */
 void SerialCommunicationTask(void const * argument)
 {
     TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t DelayTime_ms = 50;
+    const TickType_t DelayTime = configTICK_RATE_HZ / 80;  // 12.5[ms]
 
     for (;;) {
-        vTaskDelayUntil(&xLastWakeTime, DelayTime_ms * 5);
+        vTaskDelayUntil(&xLastWakeTime, DelayTime);
+
+#if USE_MOTION_PLANNER
+        // Plan moves outside of major loop
+        enqueueDemoMoves();
+#endif
+
+        // Command from PC
+        switch (readSerialChar()) {
+            case 'p':   // Output loop profile
+                PROFILER_OUTPUT();
+                break;
+            case 'r':   // Reset loop profile
+                PROFILER_RESET();
+                break;
+            case 'd':   // Output number of missed deadlines
+                printf("DeadlineMiss:Major:%lu,Minor:%lu\r\n",
+                        (unsigned long) MissCount.MajorLoop, (unsigned long) MissCount.MinorLoop);
+                break;
+            case 'k':   // Output benchmark of controller and filter kernels
+                benchmarkControlKernels();
+                break;
+            case 'e': { // Output health and error statistics of encoder
+                static const char* const HealthNames[] = { "Healthy", "Holding", "Fault" };
+                EncoderErrorStats stats;
+                readEncoderErrorStats(&stats);
+                printf("Encoder:%s,Bus:%lu,Nack:%lu,DMA:%lu,Timeout:%lu,Recovery:%lu,Fault:%lu,MaxMissed:%lu\r\n",
+                        HealthNames[getEncoderHealth()], (unsigned long) stats.BusErrors, (unsigned long) stats.Nacks,
+                        (unsigned long) stats.DMAErrors, (unsigned long) stats.Timeouts, (unsigned long) stats.Recoveries,
+                        (unsigned long) stats.Faults, (unsigned long) stats.MaxMissedSamples);
+                break;
+            }
+#if USE_REACTION_TORQUE_OBSERVER
+            case 't':   // Toggle output of estimated load torque
+                needsOutputLoadTorque = !needsOutputLoadTorque;
+                break;
+#endif
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+            case 'i':   // Change injection point of frequency response analysis
+                if (!isFRARunning(&Analyzer)) {
+                    InjectionPoint = (InjectionPointType) ((InjectionPoint + 1) % NumInjectionPoints);
+                    printf("FRA:Injection:%s\r\n", InjectionPointNames[InjectionPoint]);
+                }
+                break;
+            case 'f':   // Start (or stop) frequency response analysis with swept sine
+                if (isFRARunning(&Analyzer))
+                    stopFRA(&Analyzer);
+                else
+                    startFrequencyResponseAnalysis(SweptSine_Excitation);
+                break;
+            case 'n':   // Start (or stop) frequency response analysis with PRBS
+                if (isFRARunning(&Analyzer))
+                    stopFRA(&Analyzer);
+                else
+                    startFrequencyResponseAnalysis(PRBS_Excitation);
+                break;
+#endif
+#if USE_ENCODER_CALIBRATION
+            case 'c':   // Start (or abort) encoder calibration (control mode is changed by major loop task)
+                if (isEnabled_Control)
+                    needsToggleEncoderCalibration = true;
+                break;
+#endif
+            default:
+                break;
+        }
 
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+        if (Analyzer.Status == Finished_FRAStatus) {
+            outputFrequencyResponse();
+            stopFRA(&Analyzer);
+        }
+        // Continuous output is paused during analysis
+        if (isEnabled_Control && !isFRARunning(&Analyzer)) {
+#else
         if (isEnabled_Control) {
+#endif
             // Continuous information output
+            MonitorData monitor;
+            bool hasOutput = true;
+            readSnapshot(&MonitorSnapshot, &monitor);
             switch (ControlMode) {
                 case PositionControlMode:
-                    printf("%.4f,%.4f\r\n", PositionCmd, PositionRes);
+#if USE_FIXED_POINT_CONTROL
+                    // Counts are converted into physical units only here
+                    printf("%.4f,%.4f", PositionPerCount * (float) monitor.PositionCmd, PositionPerCount * (float) monitor.PositionRes);
+#else
+                    printf("%.4f,%.4f", monitor.PositionCmd, monitor.PositionRes);
+#endif
                     break;
                 case VelocityControlMode:
-                    printf("%.4f,%.4f\r\n", VelocityCmd, VelocityRes);
+#if USE_FIXED_POINT_CONTROL
+                    printf("%.4f,%.4f", PositionPerCount * (float) monitor.VelocityCmd, PositionPerCount * (float) monitor.VelocityRes);
+#else
+                    printf("%.4f,%.4f", monitor.VelocityCmd, monitor.VelocityRes);
+#endif
                     break;
                 case TorqueControlMode:
-                    break;
                 default:
+                    hasOutput = false;
                     break;
             }
+#if USE_REACTION_TORQUE_OBSERVER
+            if (needsOutputLoadTorque) {
+                printf(hasOutput ? ",%.4f" : "%.4f", 1000.0f * monitor.LoadTorque);
+                hasOutput = true;
+            }
+#endif
+            if (hasOutput)
+                printf("\r\n");
         }
 
+#if USE_AUTO_TUNING
+        if (needsOutputAutoTuning) {
+            // Output result of auto-tuning (gains are already applied)
+            if (AutoTunePhase == Finished_AutoTunePhase)
+                printf("AutoTune:OK\r\n");
+            else
+                printf("AutoTune:NG:%s\r\n", AutoTunePhaseNames[AutoTunePhase]);
+            printf("Current:P:%g,I:%g\r\n", Kp_c, Ki_c);
+            printf("Velocity:P:%g,I:%g\r\n", Kp_v, Ki_v);
+            printf("Position:P:%g,I:%g,D:%g\r\n", Kp_p, Ki_p, Kd_p);
+            needsOutputAutoTuning = false;
+        }
+#endif
+
+#if USE_ENCODER_CALIBRATION
+        if (needsWriteEncoderCorrection) {
+            // Flash is written by this low priority task while major loop task keeps the loops quiesced
+            isEncoderCorrectionWritten = (writeEncoderCorrectionTable(EncoderCorrection) == 0);
+            needsWriteEncoderCorrection = false;
+        }
+        if (needsOutputEncoderCalibration) {
+            // Output amplitude of fitted harmonics [count]
+            if (isEncoderCorrectionWritten) {
+                printf("EncCalib:OK");
+                for (uint32_t h = 1; h <= ENCODER_CALIB_HARMONICS; h++)
+                    printf(",H%lu:%.2f", (unsigned long) h, getEncoderCalibrationAmplitude(&EncoderCalib, h));
+                printf("\r\n");
+            } else {
+                printf("EncCalib:NG\r\n");
+            }
+            needsOutputEncoderCalibration = false;
+        }
+#endif
+
         if (needsOutputInfo) {
             // Output info when SVON switch is off and Sys button is pushed
             printf("Info:");
@@ -169,6 +579,13 @@ void SerialCommunicationTask(void const * argument)
                     break;
             }
             printf("\r\n");
+#if USE_ENCODER_ANALOG_OUTPUT
+            int16_t Deviation;
+            if (readEncoderAnalogDeviation(&Deviation) == 0)
+                printf("Encoder:Analog,Deviation:%d\r\n", Deviation);
+            else
+                printf("Encoder:I2C\r\n");     // Fallback from analog output
+#endif
             needsOutputInfo = false;
         }
     }
@@ -176,6 +593,11 @@ void SerialCommunicationTask(void const * argument)
 
 /**
  * @brief       High priority task that executes major loop control sequence
+ * @details     Sys push button
+ *              - SVON off : Output info
+ *              - SVON on and diverged : Reset divergence flag (also set when encoder health is Fault)
+ *              - SVON on (USE_AUTO_TUNING) : Start (or abort) auto-tuning, Sys LED blinks while auto-tuning
+ *              Sys LED also blinks while encoder calibration is running (USE_ENCODER_CALIBRATION).
  * @param       argument Task parameters
 */
 void MajorLoopTask(void const * argument)
@@ -184,6 +606,35 @@ void MajorLoopTask(void const * argument)
 
     // Initialization
     initEncoder();
+    PositionPerCount = getPositionResponseResolution();
+#if !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_MT)
+    initMTEstimator(&VelocityEstimator, PositionPerCount, getEncoderTimestampFrequency(), Tmt_DEFAULT);
+#elif !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_PLL)
+    initPLLEstimator(&VelocityEstimator, PositionPerCount, getEncoderTimestampFrequency(), Gpll_DEFAULT);
+#endif
+#if USE_FIXED_POINT_CONTROL
+    if (initTrajectoryCount(&DemoTrajectory, DemoSegments, sizeof(DemoSegments) / sizeof(DemoSegments[0]), dt_major, PositionPerCount))
+        Error_Handler();
+#else
+    initTrajectory(&DemoTrajectory, DemoSegments, sizeof(DemoSegments) / sizeof(DemoSegments[0]), dt_major);
+#endif
+#if USE_MOTION_PLANNER
+    initMotionPlanner(&Planner, 0.0f, dt_major);
+#endif
+#if USE_FIXED_POINT_CONTROL
+    CurrentPerCount = getCurrentResponseResolution();
+    PulsePerVoltage = getMotorPulsePerVoltage();
+    MaxPulse = getMaxMotorPulse();
+    setFixedGains(&PositionGains, Kp_p, Ki_p, Kd_p, dt_major, PositionPerCount * (Mn / Ktn) / CurrentPerCount);
+    setFixedGains(&VelocityGains, Kp_v, Ki_v, 0.0f, dt_major, PositionPerCount * (Mn / Ktn) / CurrentPerCount);
+    AccelerationGain = toFixedGain(PositionPerCount * (Mn / Ktn) / CurrentPerCount);
+#endif
+#if USE_CMSIS_DSP_CONTROL
+    // Differential term of position control uses velocity response, so Kd of PID kernel is 0
+    setPIDKernel(&PositionPID, Kp_p, Ki_p, 0.0f, dt_major, true);
+    setPIDKernel(&VelocityPID, Kp_v, Ki_v, 0.0f, dt_major, true);
+    initPseudoDifferentialKernel(&VelocityFilter, Gpd, dt_major, 0.0f);
+#endif
     if (LL_GPIO_IsInputPinSet(SVON_GPIO_Port, SVON_Pin))
         isSvonSwOn = isSvonSwOn_prev = true;
     else
@@ -196,11 +647,65 @@ void MajorLoopTask(void const * argument)
 
     resetControlVariables();
     configCurrentControl(true, Kp_c_DEFAULT, Ki_c_DEFAULT);
-    setPositionResponse(0.0f, &VelocityResInt);
+    resetPositionResponse();
     enableControl();
 
+    // Releases during the initialization above (blocking I2C reads) are not deadline misses
+#if USE_ISR_MINOR_LOOP
+    (void) ulTaskNotifyTake(pdTRUE, 0);
+#else
+    xLastWakeTime = xTaskGetTickCount();
+#endif
+    MissCount.MajorLoop = 0;
+    MissCount.MinorLoop = 0;
+    bool isMajorLoopExecuted = false;
+
     for (;;) {
-        vTaskDelayUntil(&xLastWakeTime, 4);
+        uint32_t nMissed;
+#if USE_ISR_MINOR_LOOP
+        // Released by MinorLoopISR every MINOR_LOOPS_PER_MAJOR_LOOP periods
+        // (more than one pending notification means that releases were missed)
+        (void) xLastWakeTime;
+        nMissed = ulTaskNotifyTake(pdTRUE, portMAX_DELAY) - 1;
+#else
+        vTaskDelayUntil(&xLastWakeTime, MINOR_LOOPS_PER_MAJOR_LOOP);
+        // Drop missed releases so that vTaskDelayUntil does not catch up
+        nMissed = (xTaskGetTickCount() - xLastWakeTime) / MINOR_LOOPS_PER_MAJOR_LOOP;
+        xLastWakeTime += nMissed * MINOR_LOOPS_PER_MAJOR_LOOP;
+#endif
+        // Profile covers release jitter and the whole period (jitter is not measured over missed or skipped releases)
+        if (nMissed)
+            PROFILER_SKIP(MajorControlLoop_Profile);
+        PROFILER_BEGIN(MajorControlLoop_Profile);
+        if (nMissed || !isMajorLoopExecuted)
+            PROFILER_SKIP(ReadPositionResponse_Profile);
+        isMajorLoopExecuted = false;
+
+        ElapsedMajorTicks += 1 + nMissed;
+        if (handleDeadlineMiss(nMissed, &MissCount.MajorLoop, MAJOR_LOOP_OVERRUN_POLICY))
+            continue;
+
+#if USE_ENCODER_CALIBRATION
+        if (isQuiesced) {
+            // Motor is stopped until serial communication task has written the encoder correction table
+            stopMotor();
+            ElapsedMajorTicks = 0;
+            if (needsWriteEncoderCorrection)
+                continue;
+            // Releases pending from the flash stall are dropped without counting
+#if USE_ISR_MINOR_LOOP
+            (void) ulTaskNotifyTake(pdTRUE, 0);
+#else
+            xLastWakeTime = xTaskGetTickCount();
+#endif
+            isQuiesced = false;
+            resumeFromEncoderCalibration();
+            continue;
+        }
+#endif
+
+        // Current loop response of this period (divergence check, anti-windup and reaction torque observer)
+        readSnapshot(&CurrentLoopResSnapshot, &InnerRes);
 
         /***** "SVON" Switch *****/
         if (LL_GPIO_IsInputPinSet(SVON_GPIO_Port, SVON_Pin))
@@ -229,9 +734,16 @@ void MajorLoopTask(void const * argument)
                 if (hasDiverged) {
                     // reset divergence flag
                     resetControlVariables();
-                    setPositionResponse(0.0f, &VelocityResInt);
+                    resetPositionResponse();
                     hasDiverged = false;
                     enableControl();
+#if USE_AUTO_TUNING
+                } else if (ControlMode == AutoTuneControlMode) {
+                    changeControlMode(None_ControlMode);    // Abort auto-tuning (tuned loops keep new gains)
+                    needsOutputAutoTuning = true;
+                } else {
+                    changeControlMode(AutoTuneControlMode);
+#endif
                 }
             } else {
                 needsOutputInfo = true;
@@ -245,49 +757,166 @@ void MajorLoopTask(void const * argument)
             if (!hasDiverged) {
                 hasDiverged = validateDivergence();
             }
+            // Encoder samples have been missing too long (same safe-stop path as divergence)
+            if (getEncoderHealth() == Fault_EncoderHealth)
+                hasDiverged = true;
         }
 
         if (hasDiverged) {
             LL_GPIO_SetOutputPin(SysLED_GPIO_Port, SysLED_Pin);
             disableControl();
+#if USE_AUTO_TUNING || USE_ENCODER_CALIBRATION
+        } else if ((ControlMode == AutoTuneControlMode) || (ControlMode == EncoderCalibControlMode)) {
+            // Blink while auto-tuning or calibrating (2.5[Hz])
+            static uint32_t BlinkCount = 0;
+            if (++BlinkCount >= 1000) {
+                BlinkCount = 0;
+                LL_GPIO_TogglePin(SysLED_GPIO_Port, SysLED_Pin);
+            }
+#endif
         } else {
             LL_GPIO_ResetOutputPin(SysLED_GPIO_Port, SysLED_Pin);
         }
 
         if (!isEnabled_Control) {
             stopMotor();
+            ElapsedMajorTicks = 0;  // Command is paused while control is disabled
             continue;
         }
 
+#if USE_ENCODER_CALIBRATION
+        if (needsToggleEncoderCalibration) {
+            needsToggleEncoderCalibration = false;
+            if (ControlMode == EncoderCalibControlMode) {
+                changeControlMode(None_ControlMode);    // Abort (correction table is not changed)
+                isEncoderCorrectionWritten = false;
+                needsOutputEncoderCalibration = true;
+            } else {
+                changeControlMode(EncoderCalibControlMode);
+            }
+        }
+#endif
+
         MajorControlLoop();
+        isMajorLoopExecuted = true;
+
+#if USE_ENCODER_CALIBRATION
+        if ((ControlMode == EncoderCalibControlMode) && !isEncoderCalibrationRunning(&EncoderCalib))
+            finishEncoderCalibration();
+#endif
+        PROFILER_END(MajorControlLoop_Profile);
     }
 }
 
 /**
  * @brief       Realtime task that executes minor loop control sequence
+ * @note        If USE_ISR_MINOR_LOOP is enabled, this task only starts ADC1 and PWM timer, then deletes itself.
+ *              Minor loop is executed in MinorLoopISR instead.
  * @param       argument Task parameters
 */
 void MinorLoopTask(void const * argument)
 {
     // Initialization
-    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*) &ADC1Value, 5) != HAL_OK) {
+    initMotorDriver();
+    // DWT cycle counter measures the start of PWM periods in MinorLoopISR
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*) &ADC1Value, ADC1_NUM_CONVERSIONS) != HAL_OK) {
         Error_Handler();
     }
 
+#if USE_ISR_MINOR_LOOP
+    vTaskDelete(NULL);
+#else
     TickType_t xLastWakeTime = xTaskGetTickCount();
-    uint64_t cnt = 0;
-    time_sec = 0.0f;
 
     for (;;) {
         vTaskDelayUntil(&xLastWakeTime, 1);
+        // Drop missed releases so that vTaskDelayUntil does not catch up
+        uint32_t nMissed = xTaskGetTickCount() - xLastWakeTime;
+        xLastWakeTime += nMissed;
+        bool needsSkip = handleDeadlineMiss(nMissed, &MissCount.MinorLoop, MINOR_LOOP_OVERRUN_POLICY);
 
-        if (isEnabled_Control) {
-            time_sec = (float) cnt * dt_minor;
-            cnt++;
-
+        if (nMissed)
+            PROFILER_SKIP(MinorControlLoop_Profile);
+        if (isEnabled_Control && !needsSkip) {
+            PROFILER_BEGIN(MinorControlLoop_Profile);
             MinorControlLoop();
+            PROFILER_END(MinorControlLoop_Profile);
+        } else {
+            PROFILER_SKIP(MinorControlLoop_Profile);
         }
     }
+#endif
+}
+
+/**
+ * @brief       Execute minor loop control sequence in interrupt context
+ * @note        This function is called from ADC1 conversion complete interrupt,
+ *              which is triggered by TIM3 update event (TRGO), so minor loop is synchronized with PWM period.
+ *              Major loop task is released every MINOR_LOOPS_PER_MAJOR_LOOP periods by task notification.
+ *              ADC1 interrupt has priority 5 (the highest one which can call FreeRTOS API),
+ *              and encoder interrupts (I2C1, DMA1_Stream0, TIM4) have priority 6, so they do not delay this function.
+ *              Deadline misses are detected in two ways.
+ *              - Entry : PWM periods without an entry since the previous one (late entry or lost conversion)
+ *                are counted from the start of the present period, which is measured by TIM3 counter and DWT cycle counter.
+ *              - Exit : the next PWM period has started during this execution (overrun).
+*/
+void MinorLoopISR(void)
+{
+    static uint32_t MajorLoopDivider = 0;
+    static uint32_t PeriodStartPrev = 0;
+    static bool isPeriodStartValid = false;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t PeriodStart = getPWMPeriodStartCycle();
+    uint32_t nLost = 0;
+    bool needsSkip;
+
+    clearPWMPeriodElapsedFlag();
+
+    if (isPeriodStartValid) {
+        const uint32_t PeriodCycles = getPWMPeriodCycles();
+        uint32_t nPeriods = (PeriodStart - PeriodStartPrev + PeriodCycles / 2) / PeriodCycles;
+        if (nPeriods > 1)
+            nLost = nPeriods - 1;
+    }
+    PeriodStartPrev = PeriodStart;
+    isPeriodStartValid = true;
+    needsSkip = handleDeadlineMiss(nLost, &MissCount.MinorLoop, MINOR_LOOP_OVERRUN_POLICY) || needsSkipMinorLoop;
+    if (nLost)
+        PROFILER_SKIP(MinorControlLoop_Profile);
+
+    if (isEnabled_Control && !needsSkip) {
+        PROFILER_BEGIN(MinorControlLoop_Profile);
+        MinorControlLoop();
+        PROFILER_END(MinorControlLoop_Profile);
+    } else {
+        PROFILER_SKIP(MinorControlLoop_Profile);    // Jitter is not measured over the skipped release
+    }
+    needsSkipMinorLoop = false;
+
+    // Next PWM period has already started, so this cycle missed its deadline
+    if (isPWMPeriodElapsed()) {
+        needsSkipMinorLoop = handleDeadlineMiss(1, &MissCount.MinorLoop, MINOR_LOOP_OVERRUN_POLICY);
+    }
+
+    // Lost periods are also counted, so major loop keeps the release phase (lost releases are counted by minor loop only)
+    MajorLoopDivider += 1 + nLost;
+    if (MajorLoopDivider >= MINOR_LOOPS_PER_MAJOR_LOOP) {
+        MajorLoopDivider %= MINOR_LOOPS_PER_MAJOR_LOOP;
+        vTaskNotifyGiveFromISR(MajorLoopControlHandle, &xHigherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/**
+ * @brief       Get number of missed deadlines of each control loop
+ * @param[out]  pCount Pointer of deadline miss count
+*/
+void getDeadlineMissCount(DeadlineMissCount* pCount)
+{
+    pCount->MajorLoop = MissCount.MajorLoop;
+    pCount->MinorLoop = MissCount.MinorLoop;
 }
 
 /* Private functions ---------------------------------------------------------*/
@@ -299,16 +928,75 @@ static inline void resetControlVariables(void)
     PositionErr = 0.0f;
     VelocityErr = 0.0f;
     TorqueCmd = 0.0f;
-    AccelerationRef = 0.0f, CurrentRef = 0.0f;
+    AccelerationCmd = 0.0f, AccelerationRef = 0.0f, CurrentRef = 0.0f;
     CurrentErr = 0.0f;
 
-    PositionErrInt = 0.0f;
-    VelocityErrInt = 0.0f;
-    VelocityResInt = PositionRes;
-    CurrentErrInt = 0.0f;
-    VoltageRef = 0.0f;
+    resetController(&PositionState, 0.0f, 0.0f);
+    resetController(&VelocityState, 0.0f, 0.0f);
+    rebasePseudoDiff(&VelocityResCoeffs, &VelocityResState, PositionRes);
+#if !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_MT)
+    resetMTEstimator(&VelocityEstimator);
+#elif !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_PLL)
+    resetPLLEstimator(&VelocityEstimator);
+#elif !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_KALMAN)
+    resetKalmanFilter(&StateEstimator);
+#endif
+#if USE_FIXED_POINT_CONTROL
+    PositionErrIntCount = 0;
+    VelocityErrIntCount = 0;
+    initFixedPseudoDifferential(&VelocityPD, Gpd, dt_major, PositionResCount);
+    CurrentCmdCount = 0;
+#endif
+#if USE_MOTION_PLANNER
+    resetMotion(&Planner, PositionRes);     // Start from present position without jump
+#endif
+#if USE_CMSIS_DSP_CONTROL
+    arm_pid_reset_f32(&PositionPID);
+    arm_pid_reset_f32(&VelocityPID);
+    resetBiquadKernel(&VelocityFilter, PositionRes, 0.0f);
+#endif
 
-    //resetDOBVariables(); // reset Disturbance observer variables (Not implemented)
+    // Current loop variables are reset by minor loop itself
+    CurrentCmd = 0.0f;
+    CurrentLoopResetCount++;
+    publishCurrentLoopCommand();
+
+    resetDOB(&DisturbanceCoeffs, &DisturbanceState, VelocityRes);
+    resetDOB(&LoadTorqueCoeffs.Observer, &LoadTorqueState, VelocityRes);
+    LoadTorque = 0.0f;
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+    stopFRA(&Analyzer);     // Result is not valid across reset
+#endif
+#if USE_AUTO_TUNING
+    if (ControlMode == AutoTuneControlMode)
+        changeControlMode(None_ControlMode);    // Auto-tuning is aborted by reset
+#endif
+#if USE_ENCODER_CALIBRATION
+    if (ControlMode == EncoderCalibControlMode)
+        changeControlMode(None_ControlMode);    // Encoder calibration is aborted by reset
+#endif
+}
+
+/**
+ * @brief       Set the present position response to 0
+*/
+static inline void resetPositionResponse(void)
+{
+    setPositionResponse(0.0f);
+    rebasePseudoDiff(&VelocityResCoeffs, &VelocityResState, 0.0f);
+#if USE_FIXED_POINT_CONTROL
+    PositionResCount = 0;
+    initFixedPseudoDifferential(&VelocityPD, Gpd, dt_major, PositionResCount);
+#endif
+#if USE_CMSIS_DSP_CONTROL
+    resetBiquadKernel(&VelocityFilter, 0.0f, 0.0f);
+#endif
+#if !USE_FIXED_POINT_CONTROL && (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_KALMAN)
+    resetKalmanFilter(&StateEstimator);
+#endif
+#if USE_MOTION_PLANNER
+    resetMotion(&Planner, 0.0f);
+#endif
 }
 
 /**
@@ -317,39 +1005,116 @@ static inline void resetControlVariables(void)
 static inline void MajorControlLoop(void)
 {
     // Command
-    float fmodf_time = fmodf(time_sec, 2.5f);
-    float PosCmd, VelCmd;
-    if (fmodf_time < 1.0f) {
-        PosCmd = 1.0f * sinf(1.0f * 2.0f * M_PI * fmodf_time);
-        VelCmd = 1.0f * 2.0f * M_PI * 1.0f * cosf(1.0f * 2.0f * M_PI * fmodf_time);
-    } else if (fmodf_time < 1.5f) {
-        PosCmd = 0.0f;
-        VelCmd = 0.0f;
-    } else if (fmodf_time < 2.0f) {
-        PosCmd = 1.0f;
-        VelCmd = 0.0f;
-    } else {
-        PosCmd = 0.0f;
+#if USE_FIXED_POINT_CONTROL
+    int32_t PosCmd, VelCmd, AccCmd;     // [count], [count/s], [count/s^2]
+#else
+    float PosCmd, VelCmd, AccCmd;
+#endif
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+    bool isAnalyzing = isFRARunning(&Analyzer);
+    if (isAnalyzing)
+        ElapsedMajorTicks = 0;  // Command source is paused, so the response contains only the excitation
+#endif
+#if USE_AUTO_TUNING || USE_ENCODER_CALIBRATION
+    if ((ControlMode == AutoTuneControlMode) || (ControlMode == EncoderCalibControlMode))
+        ElapsedMajorTicks = 0;  // Command source is paused during auto-tuning and encoder calibration
+#endif
+#if USE_MOTION_PLANNER
+    MotionReference ref;
+    calcMotion(&Planner, ElapsedMajorTicks, &ref);
+    PosCmd = ref.Position;
+    VelCmd = ref.Velocity;
+    AccCmd = ref.Acceleration;
+#elif USE_FIXED_POINT_CONTROL
+    calcTrajectoryCount(&DemoTrajectory, ElapsedMajorTicks, &PosCmd, &VelCmd, &AccCmd);
+#else
+    calcTrajectory(&DemoTrajectory, ElapsedMajorTicks, &PosCmd, &VelCmd, &AccCmd);
+#endif
+    ElapsedMajorTicks = 0;
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+    if (isAnalyzing) {
         VelCmd = 0.0f;
+        AccCmd = 0.0f;
     }
-    /*PositionControl(PosCmd * (0.1f+Param1), VelCmd * (0.1f+Param1),
+#endif
+    /*PositionControl(PosCmd * (0.1f+Param1), VelCmd * (0.1f+Param1), AccCmd * (0.1f+Param1),
             (0.5f+Param2) * Kp_p_DEFAULT,
             (0.5f+Param3) * Ki_p_DEFAULT,
             (0.5f+Param4) * Kd_p_DEFAULT);*/
-    PositionControl(PosCmd, VelCmd, Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT);
+#if USE_AUTO_TUNING || USE_ENCODER_CALIBRATION
+    if ((ControlMode != AutoTuneControlMode) && (ControlMode != EncoderCalibControlMode))
+#endif
+#if USE_FIXED_POINT_CONTROL
+    PositionControlCount(PosCmd, VelCmd, AccCmd);
+#else
+    PositionControl(PosCmd, VelCmd, AccCmd, Kp_p, Ki_p, Kd_p);
+#endif
 
     //VelocityControl(10.0f, Kp_v_DEFAULT, Ki_v_DEFAULT);
     //TorqueControl(0.0002f);
 
-
+#if USE_FIXED_POINT_CONTROL
     // Obtain position response
-    if (readPositionResponse(&PositionRes)) {
+    PROFILER_BEGIN(ReadPositionResponse_Profile);
+    int PosReadStatus = readPositionResponseCount(&PositionResCount);
+    PROFILER_END(ReadPositionResponse_Profile);
+    if (PosReadStatus) {
         return;     // Error
     }
 
     // Velocity response calculation via pseudo-differential
-    VelocityResInt += VelocityRes * dt_major;
-    VelocityRes = Gpd * (PositionRes - VelocityResInt);
+    VelocityResCount = calcFixedPseudoDifferential(&VelocityPD, PositionResCount);
+
+    // Major loop controller (output : current command [count])
+    switch (ControlMode) {
+        case PositionControlMode:
+            CurrentCmdCount = calcFixedPIDAntiWindup(&PositionGains, &PositionErrIntCount,
+                    PositionCmdCount - PositionResCount, VelocityCmdCount - VelocityResCount, InnerRes.Saturation)
+                    + AccelerationCmdCount;
+            break;
+        case VelocityControlMode:
+            CurrentCmdCount = calcFixedPIDAntiWindup(&VelocityGains, &VelocityErrIntCount,
+                    VelocityCmdCount - VelocityResCount, 0, InnerRes.Saturation);
+            break;
+        case TorqueControlMode:
+            CurrentCmdCount = TorqueCmdCount;
+            break;
+        default:
+            break;
+    }
+#else
+    // Obtain position response (encoder calibration needs the angle of the sample)
+#if (VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_PSEUDO_DIFF) && !USE_ENCODER_CALIBRATION
+    PROFILER_BEGIN(ReadPositionResponse_Profile);
+    int PosReadStatus = readPositionResponse(&PositionRes);
+    PROFILER_END(ReadPositionResponse_Profile);
+#else
+    EncoderSample Sample;
+    PROFILER_BEGIN(ReadPositionResponse_Profile);
+    int PosReadStatus = readEncoderSample(&Sample);
+    PROFILER_END(ReadPositionResponse_Profile);
+#endif
+    if (PosReadStatus) {
+        return;     // Error
+    }
+#if (VELOCITY_ESTIMATOR != VELOCITY_ESTIMATOR_PSEUDO_DIFF) || USE_ENCODER_CALIBRATION
+    PositionRes = PositionPerCount * (float) Sample.Count;
+#endif
+
+    // Velocity response calculation
+#if VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_MT
+    VelocityRes = calcMTEstimator(&VelocityEstimator, Sample.AbsoluteCount, Sample.Timestamp);
+#elif VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_PLL
+    VelocityRes = calcPLLEstimator(&VelocityEstimator, Sample.AbsoluteCount, Sample.Timestamp);
+#elif VELOCITY_ESTIMATOR == VELOCITY_ESTIMATOR_KALMAN
+    calcKalmanFilter(&StateEstimatorCoeffs, &StateEstimator, PositionRes, Sample.Timestamp, InnerRes.CurrentRes);
+    PositionRes = StateEstimator.Position;  // Predicted position compensates latency of I2C read
+    VelocityRes = StateEstimator.Velocity;
+#elif USE_CMSIS_DSP_CONTROL
+    VelocityRes = calcBiquadKernel(&VelocityFilter, PositionRes);
+#else
+    VelocityRes = calcPseudoDiff(&VelocityResCoeffs, &VelocityResState, PositionRes);
+#endif
 
     static const float inv_Mn = 1.0 / Mn;
     // Major loop controller
@@ -357,70 +1122,242 @@ static inline void MajorControlLoop(void)
         case PositionControlMode:
             PositionErr = PositionCmd - PositionRes;
             VelocityErr = VelocityCmd - VelocityRes;
-            PositionErrInt += PositionErr * dt_major;
-            AccelerationRef = Kp_p * PositionErr + Kd_p * VelocityErr + Ki_p * PositionErrInt;
+#if USE_CMSIS_DSP_CONTROL
+            AccelerationRef = calcPIDKernelAntiWindup(&PositionPID, PositionErr, InnerRes.Saturation)
+                    + Kd_p * VelocityErr + AccelerationCmd;
+#else
+            AccelerationRef = calcPIDAntiWindup(&PositionCoeffs, &PositionState, PositionErr, VelocityErr, InnerRes.Saturation)
+                    + AccelerationCmd;
+#endif
             break;
+#if USE_ENCODER_CALIBRATION
+        case EncoderCalibControlMode:
+            updateEncoderCalibration(&EncoderCalib, Sample.AbsoluteCount, Sample.Angle, Sample.Timestamp);
+            // fall through (velocity control)
+#endif
         case VelocityControlMode:
             VelocityErr = VelocityCmd - VelocityRes;
-            VelocityErrInt += VelocityErr * dt_major;
-            AccelerationRef = Kp_v * VelocityErr + Ki_v * VelocityErrInt;
+#if USE_CMSIS_DSP_CONTROL
+            AccelerationRef = calcPIDKernelAntiWindup(&VelocityPID, VelocityErr, InnerRes.Saturation);
+#else
+            AccelerationRef = calcPIAntiWindup(&VelocityCoeffs, &VelocityState, VelocityErr, InnerRes.Saturation);
+#endif
             break;
         case TorqueControlMode:
             AccelerationRef = TorqueCmd * inv_Mn;
             break;
+#if USE_AUTO_TUNING
+        case AutoTuneControlMode:
+            AccelerationRef = calcAutoTuning();
+            break;
+#endif
         default:
             break;
     }
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+    if ((InjectionPoint == AccelerationReference_InjectionPoint) && isAnalyzing) {
+        // Open-loop transfer function : -(controller output)/(acceleration reference)
+        float ControllerOutput = AccelerationRef;
+        AccelerationRef += calcFRAExcitation(&Analyzer);
+        updateFRA(&Analyzer, AccelerationRef, -ControllerOutput);
+    }
+#endif
     static const float Acceleration2Current = Mn / Ktn;
     CurrentRef = AccelerationRef * Acceleration2Current;
 
+#if USE_DISTURBANCE_OBSERVER
+    // Compensate disturbance estimated from nominal model
+    CurrentCmd = calcDOB(&DisturbanceCoeffs, &DisturbanceState, CurrentRef, VelocityRes);
+#else
     CurrentCmd = CurrentRef;
-    //CurrentCmd = DOB(CurrentRef, VelocityRes); // Execute disturbance observer (Not implemented)
-
-    if (!isEnabled_CurrentControl) {
-        VoltageRef = CurrentCmd * Rn;
-        setMotorVoltage(VoltageRef);
+#endif
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+    if ((InjectionPoint == CurrentCommand_InjectionPoint) && isAnalyzing) {
+        CurrentCmd += calcFRAExcitation(&Analyzer);
+        updateFRA(&Analyzer, CurrentCmd, VelocityRes);
     }
+#endif
+#endif
+
+    // Hand current command to minor loop (voltage is output by minor loop even if current control is disabled)
+    publishCurrentLoopCommand();
+
+#if USE_REACTION_TORQUE_OBSERVER
+    // Estimate external load torque from current response (same snapshot as anti-windup)
+    LoadTorque = calcRTOB(&LoadTorqueCoeffs, &LoadTorqueState, InnerRes.CurrentRes, VelocityRes);
+#endif
+
+#if USE_FIXED_POINT_CONTROL
+    MonitorData monitor = { PositionCmdCount, PositionResCount, VelocityCmdCount, VelocityResCount };
+#else
+    MonitorData monitor = { PositionCmd, PositionRes, VelocityCmd, VelocityRes, LoadTorque };
+#endif
+    writeSnapshot(&MonitorSnapshot, monitor);
 }
 
 /**
- * @brief       Major control loop (Period : 50[us])
+ * @brief       Minor control loop (Period : 50[us])
 */
 static inline void MinorControlLoop(void)
 {
+    static uint32_t ResetCount = 0;
+    static int Saturation = 0;      // Saturation of previous voltage reference
+    CurrentLoopCommand cmd;
+    CurrentLoopResponse res;
+
+    readSnapshot(&CurrentLoopCmdSnapshot, &cmd);
+    if (cmd.ResetCount != ResetCount) {
+        ResetCount = cmd.ResetCount;
+        Saturation = 0;
+#if USE_FIXED_POINT_CONTROL
+        CurrentErrIntCount = 0;
+#else
+        CurrentErr = 0.0f;
+        resetController(&CurrentState, 0.0f, 0.0f);
+        VoltageRef = 0.0f;
+#endif
+#if USE_CMSIS_DSP_CONTROL
+        arm_pid_reset_f32(&CurrentPID);
+#endif
+    }
+
+#if USE_FIXED_POINT_CONTROL
+    // read current response [count]
+    int32_t CurrentResCount = readCurrentResponseCount();
+    int32_t PulseRef;
+
+    if (cmd.isEnabled) {
+        // Minor loop controller (PI current control, output : PWM compare value)
+        PulseRef = calcFixedPIDAntiWindup(&cmd.CurrentGains, &CurrentErrIntCount, cmd.CurrentCmd - CurrentResCount, 0, Saturation);
+#if USE_VOLTAGE_FEEDFORWARD
+        PulseRef += calcFixedGain(cmd.ResistanceGain, cmd.CurrentCmd);
+#endif
+    } else {
+        PulseRef = calcFixedGain(cmd.ResistanceGain, cmd.CurrentCmd);
+    }
+#if USE_VOLTAGE_FEEDFORWARD
+    // Back-EMF compensation (current control handles only the residual)
+    PulseRef += calcFixedGain(cmd.BackEMFGain, cmd.VelocityRes);
+#endif
+
+    // Output voltage
+    setMotorPulse(saturateFixed(PulseRef, MaxPulse));
+    Saturation = (PulseRef >= MaxPulse) ? 1 : ((PulseRef <= -MaxPulse) ? -1 : 0);
+
+    res.CurrentRes = CurrentResCount;
+    res.VoltageRef = PulseRef;
+    res.Saturation = Saturation;
+    writeSnapshot(&CurrentLoopResSnapshot, res);
+#else
     // read current response
     CurrentRes = readCurrentResponse();
 
-    if(!isEnabled_CurrentControl)
-        return;
+#if USE_AUTO_TUNING
+    if (isRelayExperimentRunning(&CurrentRelay)) {
+        // Relay feedback experiment of current loop (current command is 0)
+        CurrentErr = -CurrentRes;
+        VoltageRef = calcRelayExperiment(&CurrentRelay, CurrentErr);
+    } else
+#endif
+    if (cmd.isEnabled) {
+        CurrentErr = cmd.CurrentCmd - CurrentRes;
+#if USE_DEADBEAT_CURRENT_CONTROL
+        // Minor loop controller (deadbeat current control, resistive drop and back-EMF are included in the model)
+        VoltageRef = calcDeadbeat(&CurrentDeadbeatCoeffs, &CurrentState, cmd.CurrentCmd, CurrentRes, Ken * cmd.VelocityRes);
+#else
+        // Minor loop controller (PI current control)
+#if USE_CMSIS_DSP_CONTROL
+        if ((cmd.CurrentCoeffs.Kp != CurrentPID.Kp) || (cmd.CurrentCoeffs.KiTs != CurrentPID.Ki)) {
+            CurrentPID.Kp = cmd.CurrentCoeffs.Kp;
+            CurrentPID.Ki = cmd.CurrentCoeffs.KiTs;
+            CurrentPID.Kd = 0.0f;
+            arm_pid_init_f32(&CurrentPID, 0);
+        }
+        VoltageRef = calcPIDKernelAntiWindup(&CurrentPID, CurrentErr, Saturation);
+#elif USE_CONSTANT_GAINS
+        VoltageRef = calcPIAntiWindup(&CurrentCoeffs, &CurrentState, CurrentErr, Saturation);
+#else
+        VoltageRef = calcPIAntiWindup(&cmd.CurrentCoeffs, &CurrentState, CurrentErr, Saturation);
+#endif
+#if USE_VOLTAGE_FEEDFORWARD
+        // Resistive drop and back-EMF compensation (current control handles only the residual)
+        VoltageRef += Rn * cmd.CurrentCmd + Ken * cmd.VelocityRes;
+#endif
+#endif
+    } else {
+        VoltageRef = cmd.CurrentCmd * Rn;
+#if USE_VOLTAGE_FEEDFORWARD
+        VoltageRef += Ken * cmd.VelocityRes;
+#endif
+    }
 
-    // Minor loop controller (PI current control)
-    CurrentErr = CurrentCmd - CurrentRes;
-    CurrentErrInt += CurrentErr * dt_minor;
-    VoltageRef = Kp_c * CurrentErr + Ki_c * CurrentErrInt;
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+    if ((InjectionPoint == Voltage_InjectionPoint) && isFRARunning(&Analyzer)) {
+        VoltageRef += calcFRAExcitation(&Analyzer);
+        updateFRA(&Analyzer, VoltageRef, CurrentRes);
+    }
+#endif
 
     // Output voltage
     setMotorVoltage(VoltageRef);
+    Saturation = getSaturation(VoltageRef, Vm);
+
+    res.CurrentRes = CurrentRes;
+    res.VoltageRef = VoltageRef;
+    res.Saturation = Saturation;
+    writeSnapshot(&CurrentLoopResSnapshot, res);
+#endif
 }
 
 /**
  * @brief       Set position control mode and config parameters
  * @param[in]   PosCmd Position command
  * @param[in]   VelCmd Velocity command (This value should be a differential value of PosCmd)
+ * @param[in]   AccCmd Acceleration command for feedforward (This value should be a differential value of VelCmd)
  * @param[in]   P_Gain Position proportional gain
  * @param[in]   I_Gain Position integral gain
  * @param[in]   D_Gain Position differential
+ * @note        If USE_FIXED_POINT_CONTROL is enabled, commands are converted into counts here,
+ *              so commands of every major loop period should be given by PositionControlCount instead.
 */
-static inline void PositionControl(float PosCmd, float VelCmd, float P_Gain, float I_Gain, float D_Gain)
+static inline void PositionControl(float PosCmd, float VelCmd, float AccCmd, float P_Gain, float I_Gain, float D_Gain)
 {
-    ControlMode = PositionControlMode;
     PositionCmd = PosCmd;
     VelocityCmd = VelCmd;
-    Kp_p = P_Gain;
-    Ki_p = I_Gain;
-    Kd_p = D_Gain;
+#if USE_ACCELERATION_FEEDFORWARD
+    AccelerationCmd = AccCmd;
+#else
+    AccelerationCmd = 0.0f;
+#endif
+#if USE_FIXED_POINT_CONTROL
+    PositionCmdCount = (int32_t) (PosCmd / PositionPerCount);
+    VelocityCmdCount = (int32_t) (VelCmd / PositionPerCount);
+    AccelerationCmdCount = (int32_t) (AccelerationCmd * (Mn / Ktn) / CurrentPerCount);
+#endif
+    setPositionGains(P_Gain, I_Gain, D_Gain);
+    changeControlMode(PositionControlMode);
 }
 
+#if USE_FIXED_POINT_CONTROL
+/**
+ * @brief       Set position control mode and commands in counts (present gains are used)
+ * @param[in]   PosCmd Position command [count]
+ * @param[in]   VelCmd Velocity command [count/s] (This value should be a differential value of PosCmd)
+ * @param[in]   AccCmd Acceleration command for feedforward [count/s^2] (This value should be a differential value of VelCmd)
+*/
+static inline void PositionControlCount(int32_t PosCmd, int32_t VelCmd, int32_t AccCmd)
+{
+    PositionCmdCount = PosCmd;
+    VelocityCmdCount = VelCmd;
+#if USE_ACCELERATION_FEEDFORWARD
+    AccelerationCmdCount = calcFixedGain(AccelerationGain, AccCmd);
+#else
+    AccelerationCmdCount = 0;
+#endif
+    changeControlMode(PositionControlMode);
+}
+#endif
+
 /**
  * @brief       Set velocity control mode and config parameters
  * @param[in]   VelCmd Velocity command
@@ -429,10 +1366,12 @@ static inline void PositionControl(float PosCmd, float VelCmd, float P_Gain, flo
 */
 static inline void VelocityControl(float VelCmd, float P_Gain, float I_Gain)
 {
-    ControlMode = VelocityControlMode;
     VelocityCmd = VelCmd;
-    Kp_v = P_Gain;
-    Ki_v = I_Gain;
+#if USE_FIXED_POINT_CONTROL
+    VelocityCmdCount = (int32_t) (VelCmd / PositionPerCount);
+#endif
+    setVelocityGains(P_Gain, I_Gain);
+    changeControlMode(VelocityControlMode);
 }
 
 /**
@@ -441,10 +1380,282 @@ static inline void VelocityControl(float VelCmd, float P_Gain, float I_Gain)
 */
 static inline void TorqueControl(float Command)
 {
-    ControlMode = TorqueControlMode;
     TorqueCmd = Command;
+#if USE_FIXED_POINT_CONTROL
+    TorqueCmdCount = (int32_t) (Command / Ktn / CurrentPerCount);
+#endif
+    changeControlMode(TorqueControlMode);
+}
+
+/**
+ * @brief       Set position control gains (ignored if USE_CONSTANT_GAINS is enabled)
+ * @param[in]   P_Gain Position proportional gain
+ * @param[in]   I_Gain Position integral gain
+ * @param[in]   D_Gain Position differential gain
+*/
+static inline void setPositionGains(float P_Gain, float I_Gain, float D_Gain)
+{
+#if !USE_CONSTANT_GAINS
+    if ((Kp_p == P_Gain) && (Ki_p == I_Gain) && (Kd_p == D_Gain))
+        return;     // Discretize gains only when they are changed
+    Kp_p = P_Gain;
+    Ki_p = I_Gain;
+    Kd_p = D_Gain;
+    setPIDCoeffs(&PositionCoeffs, P_Gain, I_Gain, D_Gain, dt_major);
+#if USE_FIXED_POINT_CONTROL
+    setFixedGains(&PositionGains, P_Gain, I_Gain, D_Gain, dt_major, PositionPerCount * (Mn / Ktn) / CurrentPerCount);
+#endif
+#if USE_CMSIS_DSP_CONTROL
+    setPIDKernel(&PositionPID, P_Gain, I_Gain, 0.0f, dt_major, false);
+#endif
+#endif
+}
+
+/**
+ * @brief       Set velocity control gains (ignored if USE_CONSTANT_GAINS is enabled)
+ * @param[in]   P_Gain Velocity proportional gain
+ * @param[in]   I_Gain Velocity integral gain
+*/
+static inline void setVelocityGains(float P_Gain, float I_Gain)
+{
+#if !USE_CONSTANT_GAINS
+    if ((Kp_v == P_Gain) && (Ki_v == I_Gain))
+        return;     // Discretize gains only when they are changed
+    Kp_v = P_Gain;
+    Ki_v = I_Gain;
+    setPICoeffs(&VelocityCoeffs, P_Gain, I_Gain, dt_major);
+#if USE_FIXED_POINT_CONTROL
+    setFixedGains(&VelocityGains, P_Gain, I_Gain, 0.0f, dt_major, PositionPerCount * (Mn / Ktn) / CurrentPerCount);
+#endif
+#if USE_CMSIS_DSP_CONTROL
+    setPIDKernel(&VelocityPID, P_Gain, I_Gain, 0.0f, dt_major, false);
+#endif
+#endif
 }
 
+/**
+ * @brief       Change control mode (exit action of the present mode, then enter action of the new mode)
+ * @details     Called after the commands and gains of the new mode are set.
+ *              - Exit : integral term and feedforward command of the present mode are cleared.
+ *              - Enter : integral term of the new mode is initialized so that the current command continues
+ *                from the present value (bumpless transfer), and commands of inactive loops follow the present response.
+ *              Position control mode is rebased as if the position command started at the present position,
+ *                so the integral term holds the present output only and a large position error is not baked into it
+ *                (proportional and derivative terms act on the error from the next period).
+ *              Torque control mode has no integral term, so the current command changes to the torque command.
+ * @param[in]   NewMode New control mode
+*/
+static inline void changeControlMode(ControlModeType NewMode)
+{
+    if (NewMode == ControlMode)
+        return;
+
+    // Exit action
+    switch (ControlMode) {
+        case PositionControlMode:
+            resetController(&PositionState, 0.0f, 0.0f);
+            AccelerationCmd = 0.0f;
+#if USE_FIXED_POINT_CONTROL
+            PositionErrIntCount = 0;
+            AccelerationCmdCount = 0;
+#endif
+#if USE_CMSIS_DSP_CONTROL
+            arm_pid_reset_f32(&PositionPID);
+#endif
+            break;
+        case VelocityControlMode:
+            resetController(&VelocityState, 0.0f, 0.0f);
+#if USE_FIXED_POINT_CONTROL
+            VelocityErrIntCount = 0;
+#endif
+#if USE_CMSIS_DSP_CONTROL
+            arm_pid_reset_f32(&VelocityPID);
+#endif
+            break;
+#if USE_AUTO_TUNING
+        case AutoTuneControlMode:
+            stopRelayExperiment(&CurrentRelay);
+            stopRelayExperiment(&MotionRelay);
+            AccelerationRef = 0.0f;     // Relay output is not continued by the next mode
+            break;
+#endif
+#if USE_ENCODER_CALIBRATION
+        case EncoderCalibControlMode:
+            resetController(&VelocityState, 0.0f, 0.0f);
+#if USE_CMSIS_DSP_CONTROL
+            arm_pid_reset_f32(&VelocityPID);
+#endif
+            if (isEncoderCalibrationRunning(&EncoderCalib))
+                stopEncoderCalibration(&EncoderCalib);  // Result of finished calibration is kept for output
+            enableEncoderCorrection(true);
+            break;
+#endif
+        case TorqueControlMode:
+        default:
+            break;
+    }
+
+    // Enter action (controller output of the new mode is matched to the present acceleration reference)
+    switch (NewMode) {
+        case PositionControlMode:
+            // Errors are taken as 0 (command at the present position), so the integral term equals the present output
+#if USE_FIXED_POINT_CONTROL
+            rebaseFixedPID(&PositionGains, &PositionErrIntCount, CurrentCmdCount - AccelerationCmdCount, 0, 0);
+#else
+            PositionErr = PositionCmd - PositionRes;
+#if USE_CMSIS_DSP_CONTROL
+            // Previous errors of the kernel are the present error (no derivative kick), so the output is offset by Kp*Err
+            rebasePIDKernel(&PositionPID, AccelerationRef - AccelerationCmd + Kp_p * PositionErr, PositionErr);
+#else
+            rebasePID(&PositionCoeffs, &PositionState, AccelerationRef - AccelerationCmd, 0.0f, 0.0f);
+#endif
+#endif
+            break;
+        case VelocityControlMode:
+#if USE_FIXED_POINT_CONTROL
+            PositionCmdCount = PositionResCount;
+            rebaseFixedPID(&VelocityGains, &VelocityErrIntCount, CurrentCmdCount, VelocityCmdCount - VelocityResCount, 0);
+#else
+            PositionCmd = PositionRes;
+            VelocityErr = VelocityCmd - VelocityRes;
+#if USE_CMSIS_DSP_CONTROL
+            rebasePIDKernel(&VelocityPID, AccelerationRef, VelocityErr);
+#else
+            rebasePI(&VelocityCoeffs, &VelocityState, AccelerationRef, VelocityErr);
+#endif
+#endif
+            break;
+        case TorqueControlMode:
+#if USE_FIXED_POINT_CONTROL
+            PositionCmdCount = PositionResCount;
+            VelocityCmdCount = VelocityResCount;
+#else
+            PositionCmd = PositionRes;
+            VelocityCmd = VelocityRes;
+#endif
+            break;
+#if USE_AUTO_TUNING
+        case AutoTuneControlMode:
+            // Current loop first (major loop outputs 0 until the experiment finishes)
+            AutoTunePhase = Current_AutoTunePhase;
+            startRelayExperiment(&CurrentRelay, AUTOTUNE_CURRENT_RELAY, AUTOTUNE_CURRENT_HYSTERESIS,
+                    AUTOTUNE_CURRENT_LIMIT, AUTOTUNE_TIMEOUT, dt_minor);
+            break;
+#endif
+#if USE_ENCODER_CALIBRATION
+        case EncoderCalibControlMode:
+            // Raw angle is measured (position response jumps by the correction of the present angle)
+            enableEncoderCorrection(false);
+            PositionCmd = PositionRes;
+            VelocityCmd = ENCODER_CALIB_VELOCITY;
+            VelocityErr = VelocityCmd - VelocityRes;
+#if USE_CMSIS_DSP_CONTROL
+            rebasePIDKernel(&VelocityPID, AccelerationRef, VelocityErr);
+#else
+            rebasePI(&VelocityCoeffs, &VelocityState, AccelerationRef, VelocityErr);
+#endif
+            isEncoderCorrectionWritten = false;
+            startEncoderCalibration(&EncoderCalib, ENCODER_CORRECTION_TABLE_SIZE, ENCODER_CALIB_HARMONICS, ENCODER_CALIB_REVOLUTIONS,
+                    ENCODER_CALIB_SETTLE_TIME, ENCODER_CALIB_TIMEOUT, getEncoderTimestampFrequency(), dt_major);
+            break;
+#endif
+        default:
+            break;
+    }
+    ControlMode = NewMode;
+}
+
+#if USE_AUTO_TUNING
+/**
+ * @brief       Execute auto-tuning (current -> velocity -> position) in major loop
+ * @details     When an experiment finishes, the gains of the loop are applied and the experiment of the next loop starts.
+ *              After all loops are tuned (or an experiment fails), control mode is changed to None,
+ *              so the next command starts the normal control mode with the tuned gains.
+ * @return      Acceleration reference
+*/
+static inline float calcAutoTuning(void)
+{
+    float Kp, Ki;
+
+    switch (AutoTunePhase) {
+        case Current_AutoTunePhase:
+            if (isRelayExperimentRunning(&CurrentRelay))
+                return 0.0f;
+            if (calcRelayTuningGains(&CurrentRelay, AUTOTUNE_RULE, &Kp, &Ki))
+                break;
+            CurrentLoopResetCount++;    // PI current control restarts from zero integral
+            configCurrentControl(true, Kp, Ki);
+            startRelayExperiment(&MotionRelay, AUTOTUNE_VELOCITY_RELAY, AUTOTUNE_VELOCITY_HYSTERESIS,
+                    AUTOTUNE_VELOCITY_LIMIT, AUTOTUNE_TIMEOUT, dt_major);
+            AutoTunePhase = Velocity_AutoTunePhase;
+            return 0.0f;
+        case Velocity_AutoTunePhase:
+            if (isRelayExperimentRunning(&MotionRelay))
+                return calcRelayExperiment(&MotionRelay, -VelocityRes);
+            if (calcRelayTuningGains(&MotionRelay, AUTOTUNE_RULE, &Kp, &Ki))
+                break;
+            setVelocityGains(Kp, Ki);
+            AutoTunePositionCmd = PositionRes;
+            startRelayExperiment(&MotionRelay, AUTOTUNE_POSITION_RELAY, AUTOTUNE_POSITION_HYSTERESIS,
+                    AUTOTUNE_POSITION_LIMIT, AUTOTUNE_TIMEOUT, dt_major);
+            AutoTunePhase = Position_AutoTunePhase;
+            return 0.0f;
+        case Position_AutoTunePhase:
+            // Velocity feedback by the tuned proportional gain makes the double integrator oscillate at a finite frequency
+            if (isRelayExperimentRunning(&MotionRelay))
+                return calcRelayExperiment(&MotionRelay, AutoTunePositionCmd - PositionRes) - Kp_v * VelocityRes;
+            if (calcRelayTuningGains(&MotionRelay, AUTOTUNE_RULE, &Kp, &Ki))
+                break;
+            // Differential gain of position control acts on velocity error as the velocity feedback above
+            setPositionGains(Kp, Ki, Kp_v);
+            AutoTunePhase = Finished_AutoTunePhase;
+            break;
+        default:
+            break;
+    }
+
+    // Finished or failed
+    changeControlMode(None_ControlMode);
+    needsOutputAutoTuning = true;
+    return 0.0f;
+}
+#endif
+
+#if USE_ENCODER_CALIBRATION
+/**
+ * @brief       Finish encoder calibration and request serial communication task to write the result to flash
+ * @details     Instructions cannot be fetched from flash while a sector is erased, so the CPU stalls for the erase time.
+ *              The write is executed by the low priority serial communication task after the loops are quiesced here
+ *              (motor stopped, control disabled and deadline misses not counted), and major loop task resumes
+ *              when the write has finished. Control is enabled again by the SVON switch in the next period.
+*/
+static inline void finishEncoderCalibration(void)
+{
+    isEncoderCorrectionWritten = false;
+    if (generateEncoderCorrectionTable(&EncoderCalib, EncoderCorrection) == 0) {
+        disableControl();
+        stopMotor();
+        isQuiesced = true;
+        needsWriteEncoderCorrection = true;
+    }
+    changeControlMode(None_ControlMode);    // Correction is enabled again (new table after it is written)
+
+    if (!isQuiesced)
+        resumeFromEncoderCalibration();
+}
+
+/**
+ * @brief       Return to normal control after encoder calibration (and write of the correction table)
+*/
+static inline void resumeFromEncoderCalibration(void)
+{
+    // Position response jumps by the correction
+    resetControlVariables();
+    resetPositionResponse();
+    needsOutputEncoderCalibration = true;
+}
+#endif
+
 /**
  * @brief       Config current control
  * @param[in]   isEnabled Enable or disable current control (true : enable, false : disable)
@@ -454,42 +1665,222 @@ static inline void TorqueControl(float Command)
 static inline void configCurrentControl(bool isEnabled, float P_Gain, float I_Gain)
 {
     isEnabled_CurrentControl = isEnabled;
+#if !USE_CONSTANT_GAINS
     if (isEnabled_CurrentControl) {
         Kp_c = P_Gain;
         Ki_c = I_Gain;
+        setPICoeffs(&CurrentCoeffs, P_Gain, I_Gain, dt_minor);
     }
+#endif
+#if USE_FIXED_POINT_CONTROL
+    setFixedGains(&CurrentGains, Kp_c, Ki_c, 0.0f, dt_minor, CurrentPerCount * PulsePerVoltage);
+    ResistanceGain = toFixedGain(Rn * CurrentPerCount * PulsePerVoltage);
+    BackEMFGain = toFixedGain(Ken * PositionPerCount * PulsePerVoltage);
+#endif
+    publishCurrentLoopCommand();
+}
+
+/**
+ * @brief       Hand current command and current control config to minor loop
+*/
+static inline void publishCurrentLoopCommand(void)
+{
+    CurrentLoopCommand cmd;
+#if USE_FIXED_POINT_CONTROL
+    cmd.CurrentCmd = CurrentCmdCount;
+    cmd.VelocityRes = VelocityResCount;
+    cmd.CurrentGains = CurrentGains;
+    cmd.ResistanceGain = ResistanceGain;
+    cmd.BackEMFGain = BackEMFGain;
+#else
+    cmd.CurrentCmd = CurrentCmd;
+    cmd.VelocityRes = VelocityRes;
+    cmd.CurrentCoeffs = CurrentCoeffs;
+#endif
+    cmd.isEnabled = isEnabled_CurrentControl;
+    cmd.ResetCount = CurrentLoopResetCount;
+    writeSnapshot(&CurrentLoopCmdSnapshot, cmd);
 }
 
 /**
  * @brief       Validate if control state is stable
- * @param[in]   isEnabled Enable or disable current control (true : enable, false : disable)
- * @param[in]   P_Gain Current proportional gain
- * @param[in]   I_Gain Current integral gain
+ * @details     Saturation of voltage reference alone is not divergence (e.g. large step of position command).
+ *              While saturated, tracking error of the present control mode is compared every DIVERGENCE_CHECK_INTERVAL_MS,
+ *              and the saturated time is accumulated only over the intervals where the error has not decreased.
+ *              In torque control mode, there is no tracking error, so all saturated time is accumulated.
  * @retval      true : NG (Control has diverged)
- * @retval      false : OK
+ * @retval      false : OK (including saturated but recovering)
 */
 static inline bool validateDivergence(void)
 {
-    static bool isSaturated = false;
-    static uint32_t SaturatedTimeCount = 0;
+    static uint32_t SaturatedTimeCount = 0;     // Saturated time without recovery [major loop period]
+    static uint32_t IntervalCount = 0;          // Elapsed time of present check interval [major loop period]
+    static const uint32_t CheckInterval = (uint32_t) (DIVERGENCE_CHECK_INTERVAL_MS * 0.001f / dt_major + 0.5f);
+    static const uint32_t Threshold = (uint32_t) (DIVERGENCE_THRESHOLD_MS * 0.001f / dt_major + 0.5f);
+#if USE_FIXED_POINT_CONTROL
+    static int32_t IntervalStartErr = 0;        // Tracking error at the start of present check interval [count]
+    int64_t Diff;
+    int32_t Err;
+#else
+    static float IntervalStartErr = 0.0f;       // Tracking error at the start of present check interval
+    float Err;
+#endif
 
-    if ((VoltageRef > Vm) || (VoltageRef < -Vm)) {
-        isSaturated = true;
-    } else {
-        isSaturated = false;
+    if (InnerRes.Saturation == 0) {
+        SaturatedTimeCount = 0;
+        IntervalCount = 0;
+        return false;
     }
 
-    if (isSaturated) {
+    switch (ControlMode) {
+        case PositionControlMode:
+#if USE_FIXED_POINT_CONTROL
+            Diff = (int64_t) PositionCmdCount - PositionResCount;  // Subtracted without overflow, then saturated
+            Diff = (Diff < 0) ? -Diff : Diff;
+            Err = (Diff > INT32_MAX) ? INT32_MAX : (int32_t) Diff;
+#else
+            Err = fabsf(PositionErr);
+#endif
+            break;
+        case VelocityControlMode:
+#if USE_FIXED_POINT_CONTROL
+            Diff = (int64_t) VelocityCmdCount - VelocityResCount;
+            Diff = (Diff < 0) ? -Diff : Diff;
+            Err = (Diff > INT32_MAX) ? INT32_MAX : (int32_t) Diff;
+#else
+            Err = fabsf(VelocityErr);
+#endif
+            break;
+        default:
+            Err = -1;       // No tracking error
+            break;
+    }
+
+    if (Err < 0) {
         SaturatedTimeCount++;
     } else {
-        SaturatedTimeCount = 0;
+        if (IntervalCount == 0)
+            IntervalStartErr = Err;
+        if (++IntervalCount >= CheckInterval) {
+            if (Err >= IntervalStartErr)
+                SaturatedTimeCount += IntervalCount;    // Not recovering
+            IntervalStartErr = Err;
+            IntervalCount = 1;
+        }
     }
 
-    if (SaturatedTimeCount >= (DIVERGENCE_THRESHOLD_MS * 5)) {
+    if (SaturatedTimeCount >= Threshold) {
         SaturatedTimeCount = 0;
+        IntervalCount = 0;
         return true;
     }
     return false;
 }
 
+/**
+ * @brief       Count missed deadlines and apply overrun policy
+ * @param[in]   nMissed Number of missed deadlines
+ * @param[in,out] pMissCount Pointer of deadline miss counter
+ * @param[in]   Policy Overrun policy (OVERRUN_POLICY_xxx)
+ * @retval      true : The late cycle should be skipped
+ * @retval      false : The late cycle should be executed
+*/
+static inline bool handleDeadlineMiss(uint32_t nMissed, volatile uint32_t* pMissCount, int Policy)
+{
+    if ((nMissed == 0) || isQuiesced)
+        return false;   // Releases missed while the loops are quiesced are not deadline misses
+    *pMissCount += nMissed;
+
+    switch (Policy) {
+        case OVERRUN_POLICY_SKIP:
+            return true;
+        case OVERRUN_POLICY_SAFE_STOP:
+            // Same safe-stop path as divergence detection
+            hasDiverged = true;
+            disableControl();
+            stopMotor();
+            return true;
+        case OVERRUN_POLICY_RUN_LATE:
+        default:
+            return false;
+    }
+}
+
+#if USE_FREQUENCY_RESPONSE_ANALYZER
+/**
+ * @brief       Start frequency response analysis at the selected injection point
+ * @param[in]   Excitation Type of excitation
+*/
+static inline void startFrequencyResponseAnalysis(FRAExcitation Excitation)
+{
+    float Ts, Amplitude, MinFrequency, MaxFrequency;
+    int Status;
+
+    switch (InjectionPoint) {
+        case Voltage_InjectionPoint:
+            Ts = dt_minor;
+            Amplitude = FRA_VOLTAGE_AMPLITUDE;
+            MinFrequency = FRA_MINOR_MIN_FREQUENCY;
+            MaxFrequency = FRA_MINOR_MAX_FREQUENCY;
+            break;
+        case CurrentCommand_InjectionPoint:
+            Ts = dt_major;
+            Amplitude = FRA_CURRENT_AMPLITUDE;
+            MinFrequency = FRA_MAJOR_MIN_FREQUENCY;
+            MaxFrequency = FRA_MAJOR_MAX_FREQUENCY;
+            break;
+        case AccelerationReference_InjectionPoint:
+        default:
+            Ts = dt_major;
+            Amplitude = FRA_ACCELERATION_AMPLITUDE;
+            MinFrequency = FRA_MAJOR_MIN_FREQUENCY;
+            MaxFrequency = FRA_MAJOR_MAX_FREQUENCY;
+            break;
+    }
+
+    if (Excitation == SweptSine_Excitation)
+        Status = initSweptSineFRA(&Analyzer, Amplitude, MinFrequency, MaxFrequency, FRA_NUM_BINS, FRA_SINE_CYCLES, Ts);
+    else
+        Status = initPRBSFRA(&Analyzer, Amplitude, FRA_PRBS_ORDER, 1, FRA_PRBS_PERIODS, FRA_NUM_BINS, Ts);
+    if (Status) {
+        printf("FRA:Error\r\n");
+        return;
+    }
+    printf("FRA:Start:%s\r\n", InjectionPointNames[InjectionPoint]);
+    startFRA(&Analyzer);
+}
+
+/**
+ * @brief       Output Bode table of finished frequency response analysis
+*/
+static inline void outputFrequencyResponse(void)
+{
+    printf("FRA:Frequency[Hz],Gain[dB],Phase[deg]\r\n");
+    for (uint32_t i = 0; i < Analyzer.NumBins; i++) {
+        float Frequency, Gain, Phase;
+        if (getFRAResult(&Analyzer, i, &Frequency, &Gain, &Phase) == 0)
+            printf("%.3f,%.2f,%.1f\r\n", Frequency, Gain, Phase);
+    }
+    printf("FRA:End\r\n");
+}
+#endif
+
+#if USE_MOTION_PLANNER
+/**
+ * @brief       Fill motion queue with point-to-point demo moves (0 -> DEMO_MOVE_DISTANCE -> 0 with dwell)
+*/
+static inline void enqueueDemoMoves(void)
+{
+    static bool isForward = true;
+
+    while (getMotionQueueSpace(&Planner) >= 2) {
+        float Target = isForward ? DEMO_MOVE_DISTANCE : 0.0f;
+        if (enqueueMove(&Planner, Target, DEMO_MOVE_VELOCITY, DEMO_MOVE_ACCELERATION, DEMO_MOVE_JERK) != 0)
+            break;
+        enqueueDwell(&Planner, DEMO_MOVE_DWELL);
+        isForward = !isForward;
+    }
+}
+#endif
+
 /***************************************************************END OF FILE****/
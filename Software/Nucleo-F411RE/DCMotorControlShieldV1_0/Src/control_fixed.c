@@ -0,0 +1,209 @@
+/**
+ ******************************************************************************
+ * @file    control_fixed.c
+ * @brief   Source file of fixed-point controller functions
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "control_fixed.h"
+#include "control_fixed_port.h"
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static inline int32_t saturate32(int64_t);
+static inline int32_t addSat32(int32_t, int32_t);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Convert PID gains in physical units into fixed-point gains
+ * @param[out]  pGains Pointer of fixed-point gains
+ * @param[in]   Kp Proportional gain in physical units
+ * @param[in]   Ki Integral gain in physical units
+ * @param[in]   Kd Differential gain in physical units
+ * @param[in]   Ts Sampling time [s]
+ * @param[in]   Scale Conversion factor from physical gain to count gain (input unit per count / output unit per count)
+*/
+void setFixedGains(FixedGains* pGains, float Kp, float Ki, float Kd, float Ts, float Scale)
+{
+    pGains->Kp   = toFixedGain(Kp * Scale);
+    pGains->KiTs = toFixedGain(Ki * Ts * Scale);
+    pGains->Kd   = toFixedGain(Kd * Scale);
+}
+
+/**
+ * @brief       Convert gain into Q7.24 format with saturation
+ * @param[in]   Gain Gain
+ * @return      Gain in Q7.24 format
+*/
+int32_t toFixedGain(float Gain)
+{
+    const float scale = (float) (1UL << FIXED_GAIN_Q);
+    float x = Gain * scale;
+
+    if (x >= (float) INT32_MAX)
+        return INT32_MAX;
+    if (x <= (float) INT32_MIN)
+        return INT32_MIN;
+    return (int32_t) ((x >= 0.0f) ? (x + 0.5f) : (x - 0.5f));
+}
+
+/**
+ * @brief       Fixed-point PID controller
+ * @param[in]   pGains Pointer of fixed-point gains
+ * @param[in,out] pErrInt Pointer of integral of error [count * sample] (saturated)
+ * @param[in]   Err Error [count]
+ * @param[in]   dErr Differential of error [count/s]
+ * @return      Controller output [count] (saturated to int32_t)
+*/
+inline int32_t calcFixedPID(const FixedGains* pGains, int32_t* pErrInt, int32_t Err, int32_t dErr)
+{
+    *pErrInt = addSat32(*pErrInt, Err);
+
+    int64_t acc = (int64_t) pGains->Kp * Err
+                + (int64_t) pGains->Kd * dErr
+                + (int64_t) pGains->KiTs * *pErrInt;
+    return saturate32(acc >> FIXED_GAIN_Q);
+}
+
+/**
+ * @brief       Fixed-point PID controller with conditional integration anti-windup
+ * @param[in]   pGains Pointer of fixed-point gains
+ * @param[in,out] pErrInt Pointer of integral of error [count * sample] (saturated)
+ * @param[in]   Err Error [count]
+ * @param[in]   dErr Differential of error [count/s]
+ * @param[in]   Saturation Saturation status of the previous output or of the inner loop (1 : upper, -1 : lower, 0 : none)
+ * @return      Controller output [count] (saturated to int32_t)
+*/
+inline int32_t calcFixedPIDAntiWindup(const FixedGains* pGains, int32_t* pErrInt, int32_t Err, int32_t dErr, int Saturation)
+{
+    // Error is not integrated while it drives the output further into saturation
+    if (!(((Saturation > 0) && (Err > 0)) || ((Saturation < 0) && (Err < 0))))
+        *pErrInt = addSat32(*pErrInt, Err);
+
+    int64_t acc = (int64_t) pGains->Kp * Err
+                + (int64_t) pGains->Kd * dErr
+                + (int64_t) pGains->KiTs * *pErrInt;
+    return saturate32(acc >> FIXED_GAIN_Q);
+}
+
+/**
+ * @brief       Set integral of error so that the output of fixed-point PID controller for the present error is Output (bumpless transfer)
+ * @param[in]   pGains Pointer of fixed-point gains
+ * @param[out]  pErrInt Pointer of integral of error [count * sample]
+ * @param[in]   Output Output to continue from [count]
+ * @param[in]   Err Present error [count]
+ * @param[in]   dErr Present differential of error [count/s]
+*/
+void rebaseFixedPID(const FixedGains* pGains, int32_t* pErrInt, int32_t Output, int32_t Err, int32_t dErr)
+{
+    if (pGains->KiTs == 0) {
+        *pErrInt = 0;   // No integral term
+        return;
+    }
+    int64_t acc = (int64_t) Output * (1LL << FIXED_GAIN_Q)
+                - (int64_t) pGains->Kp * Err
+                - (int64_t) pGains->Kd * dErr;
+    *pErrInt = saturate32(acc / pGains->KiTs);
+}
+
+/**
+ * @brief       Multiply fixed-point gain
+ * @param[in]   Gain Gain in Q7.24 format
+ * @param[in]   x Input [count]
+ * @return      Gain * x [count] (saturated to int32_t)
+*/
+inline int32_t calcFixedGain(int32_t Gain, int32_t x)
+{
+    return saturate32(((int64_t) Gain * x) >> FIXED_GAIN_Q);
+}
+
+/**
+ * @brief       Saturate value symmetrically
+ * @param[in]   x Input
+ * @param[in]   Limit Positive limit
+ * @return      Saturated value (-Limit ~ Limit)
+*/
+inline int32_t saturateFixed(int32_t x, int32_t Limit)
+{
+    if (x > Limit)
+        return Limit;
+    if (x < -Limit)
+        return -Limit;
+    return x;
+}
+
+/**
+ * @brief       Initialize pseudo-differential filter
+ * @param[out]  pPD Pointer of pseudo-differential filter
+ * @param[in]   Gpd Cutoff frequency [rad/s]
+ * @param[in]   Ts Sampling time [s]
+ * @param[in]   PosRes Present position response [count]
+*/
+void initFixedPseudoDifferential(FixedPseudoDifferential* pPD, float Gpd, float Ts, int32_t PosRes)
+{
+    pPD->Gpd = (int32_t) (Gpd * 256.0f + 0.5f);
+    pPD->Ts  = (int32_t) (Ts * 4294967296.0f + 0.5f);
+    pPD->PosResInt = (int64_t) PosRes << 16;
+    pPD->VelRes = 0;
+}
+
+/**
+ * @brief       Calculate velocity response via pseudo-differential
+ * @param[in,out] pPD Pointer of pseudo-differential filter
+ * @param[in]   PosRes Position response [count]
+ * @return      Velocity response [count/s]
+*/
+inline int32_t calcFixedPseudoDifferential(FixedPseudoDifferential* pPD, int32_t PosRes)
+{
+    // PosResInt += VelRes * Ts
+    pPD->PosResInt += ((int64_t) pPD->VelRes * pPD->Ts) >> 16;
+    // VelRes = Gpd * (PosRes - PosResInt)
+    int64_t diff = ((int64_t) PosRes << 16) - pPD->PosResInt;
+    pPD->VelRes = saturate32((diff * pPD->Gpd) >> 24);
+    return pPD->VelRes;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Saturate 64-bit value to 32-bit
+ * @param[in]   x Input
+ * @return      Saturated value
+*/
+static inline int32_t saturate32(int64_t x)
+{
+    if (x > INT32_MAX)
+        return INT32_MAX;
+    if (x < INT32_MIN)
+        return INT32_MIN;
+    return (int32_t) x;
+}
+
+/**
+ * @brief       Saturating addition
+ * @param[in]   a Input
+ * @param[in]   b Input
+ * @return      a + b (saturated)
+*/
+static inline int32_t addSat32(int32_t a, int32_t b)
+{
+    return addSatFixedPort(a, b);
+}
+
+/***************************************************************END OF FILE****/
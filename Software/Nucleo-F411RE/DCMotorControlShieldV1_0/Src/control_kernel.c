@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file    control_kernel.c
+ * @brief   Source file of controller and filter kernels based on CMSIS-DSP
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "control_kernel.h"
+#include "control.h"
+
+/* Private function macro ----------------------------------------------------*/
+/**
+ * @brief       Measure execution time of a statement
+ * @details     Minimum time is the execution time without preemption, mean time includes preemption.
+ * @param       Name Name to output
+ * @param       Statement Statement to measure
+ */
+#define BENCHMARK_KERNEL(Name, Statement)                                       \
+    do {                                                                        \
+        uint32_t min_ = UINT32_MAX;                                             \
+        uint64_t sum_ = 0;                                                      \
+        for (uint32_t i_ = 0; i_ < BENCHMARK_ITERATIONS; i_++) {                \
+            float x = Input[i_ % BENCHMARK_INPUTS];                             \
+            uint32_t start_ = DWT->CYCCNT;                                      \
+            Statement;                                                          \
+            uint32_t cycles_ = DWT->CYCCNT - start_;                            \
+            if (cycles_ < min_)                                                 \
+                min_ = cycles_;                                                 \
+            sum_ += cycles_;                                                    \
+        }                                                                       \
+        printf("%s: min %lu, mean %.1f[cycle]\r\n", Name, (unsigned long) min_, \
+                (float) sum_ / (float) BENCHMARK_ITERATIONS);                   \
+    } while (0)
+
+/* Private macro -------------------------------------------------------------*/
+#define BENCHMARK_ITERATIONS    1000    ///< Number of executions of each kernel
+#define BENCHMARK_INPUTS        16      ///< Number of input samples
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Set gains of PID controller in physical units
+ * @details     arm_pid_f32 calculates u[n] = u[n-1] + (Kp + Ki*Ts + Kd/Ts)*e[n] - (Kp + 2*Kd/Ts)*e[n-1] + Kd/Ts*e[n-2],
+ *              which is equal to u = Kp*e + Ki*Integral(e) + Kd*Differential(e) with backward difference.
+ * @param[in,out] pPID Pointer of PID instance
+ * @param[in]   Kp Proportional gain
+ * @param[in]   Ki Integral gain
+ * @param[in]   Kd Differential gain
+ * @param[in]   Ts Sampling time [s]
+ * @param[in]   needsReset true : Reset state, false : Keep state (bumpless gain change)
+*/
+void setPIDKernel(arm_pid_instance_f32* pPID, float Kp, float Ki, float Kd, float Ts, bool needsReset)
+{
+    pPID->Kp = Kp;
+    pPID->Ki = Ki * Ts;
+    pPID->Kd = Kd / Ts;
+    arm_pid_init_f32(pPID, needsReset ? 1 : 0);
+}
+
+/**
+ * @brief       PID controller with conditional integration anti-windup
+ * @details     Ki*Ts*e[n] is included in the increment of arm_pid_f32,
+ *              so it is subtracted from the output (and the stored previous output) while the output winds up.
+ * @param[in,out] pPID Pointer of PID instance
+ * @param[in]   Err Error
+ * @param[in]   Saturation Saturation status of the previous output or of the inner loop (1 : upper, -1 : lower, 0 : none)
+ * @return      Controller output
+*/
+float calcPIDKernelAntiWindup(arm_pid_instance_f32* pPID, float Err, int Saturation)
+{
+    float Output = arm_pid_f32(pPID, Err);
+
+    if (((Saturation > 0) && (Err > 0.0f)) || ((Saturation < 0) && (Err < 0.0f))) {
+        Output -= pPID->Ki * Err;
+        pPID->state[2] = Output;
+    }
+    return Output;
+}
+
+/**
+ * @brief       Set state of PID controller so that the output for the present error is Output (bumpless transfer)
+ * @details     Previous errors are set to Err, so the next output is Output + Ki*Ts*e[n] + (Kp + Kd/Ts)*(e[n] - Err).
+ * @param[in,out] pPID Pointer of PID instance
+ * @param[in]   Output Output to continue from (e.g. output of the controller used until now)
+ * @param[in]   Err Present error
+*/
+void rebasePIDKernel(arm_pid_instance_f32* pPID, float Output, float Err)
+{
+    pPID->state[0] = Err;
+    pPID->state[1] = Err;
+    pPID->state[2] = Output;
+}
+
+/**
+ * @brief       Initialize biquad cascade filter
+ * @param[out]  pFilter Pointer of filter
+ * @param[in]   numStages Number of 2nd order stages (1 ~ BIQUAD_MAX_STAGES)
+ * @param[in]   pCoeffs Pointer of coefficients {b0, b1, b2, a1, a2} x numStages
+*/
+void initBiquadKernel(BiquadKernel* pFilter, uint8_t numStages, const float* pCoeffs)
+{
+    if (numStages > BIQUAD_MAX_STAGES)
+        numStages = BIQUAD_MAX_STAGES;
+    memcpy(pFilter->Coeffs, pCoeffs, sizeof(float32_t) * 5 * numStages);
+    arm_biquad_cascade_df1_init_f32(&pFilter->Instance, numStages, pFilter->Coeffs, pFilter->State);
+}
+
+/**
+ * @brief       Reset state of biquad cascade filter as if the input had been constant
+ * @param[in,out] pFilter Pointer of filter
+ * @param[in]   Input Past input of the first stage
+ * @param[in]   Output Past output of every stage
+*/
+void resetBiquadKernel(BiquadKernel* pFilter, float Input, float Output)
+{
+    for (uint32_t stage = 0; stage < pFilter->Instance.numStages; stage++) {
+        float32_t* pState = &pFilter->State[4 * stage];
+        pState[0] = pState[1] = (stage == 0) ? Input : Output;
+        pState[2] = pState[3] = Output;
+    }
+}
+
+/**
+ * @brief       Filter one sample
+ * @param[in,out] pFilter Pointer of filter
+ * @param[in]   Input Input sample
+ * @return      Output sample
+*/
+inline float calcBiquadKernel(BiquadKernel* pFilter, float Input)
+{
+    float32_t Output;
+    arm_biquad_cascade_df1_f32(&pFilter->Instance, &Input, &Output, 1);
+    return Output;
+}
+
+/**
+ * @brief       Initialize biquad filter as pseudo-differential (Gpd*s / (s + Gpd))
+ * @details     Same discretization as the hand-written pseudo-differential in control.c :
+ *              v[n] = Gpd*(x[n] - x[n-1]) + (1 - Gpd*Ts)*v[n-1]
+ * @param[out]  pFilter Pointer of filter
+ * @param[in]   Gpd Cutoff frequency [rad/s]
+ * @param[in]   Ts Sampling time [s]
+ * @param[in]   Input Present input (position response)
+*/
+void initPseudoDifferentialKernel(BiquadKernel* pFilter, float Gpd, float Ts, float Input)
+{
+    const float Coeffs[5] = { Gpd, -Gpd, 0.0f, 1.0f - Gpd * Ts, 0.0f };
+
+    initBiquadKernel(pFilter, 1, Coeffs);
+    resetBiquadKernel(pFilter, Input, 0.0f);
+}
+
+/**
+ * @brief       Compare execution time of hand-written code and CMSIS-DSP kernels, and output it via UART
+ * @note        This function takes a few milliseconds. Call it from a low priority task.
+*/
+void benchmarkControlKernels(void)
+{
+    static const float Input[BENCHMARK_INPUTS] = {
+        0.00f, 0.12f, 0.25f, 0.37f, 0.48f, 0.59f, 0.68f, 0.77f,
+        0.84f, 0.90f, 0.95f, 0.98f, 0.99f, 0.98f, 0.95f, 0.90f
+    };
+    // 4th order Butterworth low-pass filter (Cutoff : 2[kHz], Sampling : 20[kHz])
+    static const float LowPassCoeffs[5 * 2] = {
+        0.0619f, 0.1238f, 0.0619f, 1.0489f, -0.2962f,
+        0.0780f, 0.1559f, 0.0780f, 1.3213f, -0.6327f
+    };
+    volatile float Output;
+    float ErrInt = 0.0f, VelInt = 0.0f, Vel = 0.0f;
+    arm_pid_instance_f32 PID;
+    BiquadKernel Filter;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    printf("Benchmark: SystemCoreClock %lu[Hz], minor loop period %lu[cycle]\r\n",
+            (unsigned long) SystemCoreClock, (unsigned long) (SystemCoreClock * dt_minor + 0.5f));
+
+    // PI controller (current loop)
+    BENCHMARK_KERNEL("PI hand-written",
+            ErrInt += x * dt_minor; Output = Kp_c_DEFAULT * x + Ki_c_DEFAULT * ErrInt);
+    setPIDKernel(&PID, Kp_c_DEFAULT, Ki_c_DEFAULT, 0.0f, dt_minor, true);
+    BENCHMARK_KERNEL("PI arm_pid_f32", Output = arm_pid_f32(&PID, x));
+
+    // Pseudo-differential (major loop)
+    BENCHMARK_KERNEL("Pseudo-differential hand-written",
+            VelInt += Vel * dt_major; Vel = Gpd_DEFAULT * (x - VelInt); Output = Vel);
+    initPseudoDifferentialKernel(&Filter, Gpd_DEFAULT, dt_major, 0.0f);
+    BENCHMARK_KERNEL("Pseudo-differential arm_biquad_cascade_df1_f32", Output = calcBiquadKernel(&Filter, x));
+
+    // Higher order filter
+    initBiquadKernel(&Filter, 2, LowPassCoeffs);
+    resetBiquadKernel(&Filter, 0.0f, 0.0f);
+    BENCHMARK_KERNEL("4th order low-pass arm_biquad_cascade_df1_f32", Output = calcBiquadKernel(&Filter, x));
+
+    (void) Output;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/***************************************************************END OF FILE****/
@@ -0,0 +1,223 @@
+/**
+ ******************************************************************************
+ * @file    encoder_calibration.c
+ * @brief   Source file of encoder nonlinearity calibration (Fourier fit of position-periodic error)
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "encoder_calibration.h"
+#include "stm32f4xx.h"  // __DMB
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define ENCODER_CALIB_PI    3.14159265f
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static inline void finishEncoderCalibration(EncoderCalibration*, EncoderCalibStatus);
+static inline void beginMeasurement(EncoderCalibration*, uint32_t, uint32_t, EncoderCalibStatus);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Start encoder calibration
+ * @note        Call only when the calibration is not running (the control loop accesses it only while running).
+ * @param[out]  pCalib Pointer of calibration
+ * @param[in]   CountsPerRev Encoder counts per revolution
+ * @param[in]   Harmonics Number of fitted harmonics (1 ~ ENCODER_CALIB_MAX_HARMONICS)
+ * @param[in]   Revolutions Revolutions of each measurement
+ * @param[in]   SettleTime Time discarded before measurement [s]
+ * @param[in]   Timeout Calibration fails if not finished within this time [s]
+ * @param[in]   TimestampFrequency Frequency of timestamp of encoder sample [Hz]
+ * @param[in]   Ts Sampling time [s]
+ * @retval      0 : OK
+ * @retval      -1 : Invalid parameter
+*/
+int startEncoderCalibration(EncoderCalibration* pCalib, uint32_t CountsPerRev, uint32_t Harmonics, uint32_t Revolutions,
+        float SettleTime, float Timeout, float TimestampFrequency, float Ts)
+{
+    if ((CountsPerRev == 0) || (Harmonics == 0) || (Harmonics > ENCODER_CALIB_MAX_HARMONICS) || (Revolutions == 0))
+        return -1;
+
+    pCalib->CountsPerRev = CountsPerRev;
+    pCalib->Harmonics = Harmonics;
+    pCalib->Revolutions = Revolutions;
+    pCalib->SettleSamples = (uint32_t) (SettleTime / Ts);
+    pCalib->Timeout = (uint32_t) (Timeout / Ts);
+    pCalib->TimestampFrequency = TimestampFrequency;
+    pCalib->SampleCount = 0;
+    pCalib->Slope = 0.0f;
+
+    // Publish the configuration before the control loop starts to use it
+    __DMB();
+    pCalib->Status = Settling_EncoderCalibStatus;
+    return 0;
+}
+
+/**
+ * @brief       Stop encoder calibration (result is discarded)
+ * @param[in,out] pCalib Pointer of calibration
+*/
+void stopEncoderCalibration(EncoderCalibration* pCalib)
+{
+    pCalib->Status = Idle_EncoderCalibStatus;
+}
+
+/**
+ * @brief       Update calibration with an encoder sample (call once per sampling period while running)
+ * @param[in,out] pCalib Pointer of calibration
+ * @param[in]   Count Free-running position [count] (wraps around)
+ * @param[in]   Angle Single-turn angle read from the encoder (0 ~ CountsPerRev - 1) [count]
+ * @param[in]   Timestamp Time when the sample was taken
+*/
+void updateEncoderCalibration(EncoderCalibration* pCalib, uint32_t Count, uint16_t Angle, uint32_t Timestamp)
+{
+    if (!isEncoderCalibrationRunning(pCalib))
+        return;
+
+    if (++pCalib->SampleCount >= pCalib->Timeout) {
+        finishEncoderCalibration(pCalib, Failed_EncoderCalibStatus);
+        return;
+    }
+
+    int32_t dCount = (int32_t) (Count - pCalib->StartCount);
+    uint32_t Distance = (uint32_t) ((dCount >= 0) ? dCount : -dCount);
+    float Time = (float) (Timestamp - pCalib->StartTimestamp) / pCalib->TimestampFrequency;
+
+    switch (pCalib->Status) {
+        case Settling_EncoderCalibStatus:
+            if (pCalib->SampleCount >= pCalib->SettleSamples)
+                beginMeasurement(pCalib, Count, Timestamp, Slope_EncoderCalibStatus);
+            break;
+        case Slope_EncoderCalibStatus:
+            if (Distance >= pCalib->Revolutions * pCalib->CountsPerRev) {
+                pCalib->Slope = (float) dCount / Time;
+                beginMeasurement(pCalib, Count, Timestamp, Fourier_EncoderCalibStatus);
+            }
+            break;
+        case Fourier_EncoderCalibStatus: {
+            // Residual from the line, correlated with harmonics of the angle (cos/sin of h*angle by rotation)
+            float Residual = (float) dCount - pCalib->Slope * Time;
+            float Theta = 2.0f * ENCODER_CALIB_PI * (float) Angle / (float) pCalib->CountsPerRev;
+            float c1 = cosf(Theta), s1 = sinf(Theta);
+            float c = c1, s = s1;
+            for (uint32_t h = 0; h < pCalib->Harmonics; h++) {
+                pCalib->ResidualCosSum[h] += Residual * c;
+                pCalib->ResidualSinSum[h] += Residual * s;
+                pCalib->CosSum[h] += c;
+                pCalib->SinSum[h] += s;
+                float c_next = c * c1 - s * s1;
+                s = s * c1 + c * s1;
+                c = c_next;
+            }
+            pCalib->ResidualSum += Residual;
+            pCalib->NumSamples++;
+
+            if (Distance >= pCalib->Revolutions * pCalib->CountsPerRev) {
+                // Mean of residual (offset of the line) is removed
+                float n = (float) pCalib->NumSamples;
+                float Mean = pCalib->ResidualSum / n;
+                for (uint32_t h = 0; h < pCalib->Harmonics; h++) {
+                    pCalib->CosCoeff[h] = 2.0f * (pCalib->ResidualCosSum[h] - Mean * pCalib->CosSum[h]) / n;
+                    pCalib->SinCoeff[h] = 2.0f * (pCalib->ResidualSinSum[h] - Mean * pCalib->SinSum[h]) / n;
+                }
+                finishEncoderCalibration(pCalib, Finished_EncoderCalibStatus);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief       Generate correction table from the result of calibration
+ * @param[in]   pCalib Pointer of finished calibration
+ * @param[out]  pTable Correction table (CountsPerRev elements), pTable[Angle] is added to position [count]
+ * @retval      0 : OK
+ * @retval      -1 : Calibration has not finished successfully
+*/
+int generateEncoderCorrectionTable(const EncoderCalibration* pCalib, int8_t* pTable)
+{
+    if (pCalib->Status != Finished_EncoderCalibStatus)
+        return -1;
+
+    for (uint32_t i = 0; i < pCalib->CountsPerRev; i++) {
+        float Theta = 2.0f * ENCODER_CALIB_PI * (float) i / (float) pCalib->CountsPerRev;
+        float Error = 0.0f;
+        for (uint32_t h = 0; h < pCalib->Harmonics; h++)
+            Error += pCalib->CosCoeff[h] * cosf((float) (h + 1) * Theta) + pCalib->SinCoeff[h] * sinf((float) (h + 1) * Theta);
+        Error = roundf(-Error);
+        if (Error > 127.0f)
+            Error = 127.0f;
+        else if (Error < -127.0f)
+            Error = -127.0f;
+        pTable[i] = (int8_t) Error;
+    }
+    return 0;
+}
+
+/**
+ * @brief       Get amplitude of a fitted harmonic
+ * @param[in]   pCalib Pointer of finished calibration
+ * @param[in]   Harmonic Order of harmonic (1 ~ Harmonics)
+ * @return      Amplitude of position error [count] (0 if not available)
+*/
+float getEncoderCalibrationAmplitude(const EncoderCalibration* pCalib, uint32_t Harmonic)
+{
+    if ((pCalib->Status != Finished_EncoderCalibStatus) || (Harmonic == 0) || (Harmonic > pCalib->Harmonics))
+        return 0.0f;
+    return sqrtf(pCalib->CosCoeff[Harmonic - 1] * pCalib->CosCoeff[Harmonic - 1]
+            + pCalib->SinCoeff[Harmonic - 1] * pCalib->SinCoeff[Harmonic - 1]);
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Begin a measurement from the present sample
+ * @param[in,out] pCalib Pointer of calibration
+ * @param[in]   Count Present position [count]
+ * @param[in]   Timestamp Present timestamp
+ * @param[in]   Status Slope or Fourier
+*/
+static inline void beginMeasurement(EncoderCalibration* pCalib, uint32_t Count, uint32_t Timestamp, EncoderCalibStatus Status)
+{
+    pCalib->StartCount = Count;
+    pCalib->StartTimestamp = Timestamp;
+    pCalib->NumSamples = 0;
+    pCalib->ResidualSum = 0.0f;
+    for (uint32_t h = 0; h < pCalib->Harmonics; h++) {
+        pCalib->ResidualCosSum[h] = pCalib->ResidualSinSum[h] = 0.0f;
+        pCalib->CosSum[h] = pCalib->SinSum[h] = 0.0f;
+    }
+    pCalib->Status = Status;
+}
+
+/**
+ * @brief       Finish encoder calibration
+ * @param[in,out] pCalib Pointer of calibration
+ * @param[in]   Status Finished or failed
+*/
+static inline void finishEncoderCalibration(EncoderCalibration* pCalib, EncoderCalibStatus Status)
+{
+    // Result is stored before it is published to the reader
+    __DMB();
+    pCalib->Status = Status;
+}
+
+/***************************************************************END OF FILE****/
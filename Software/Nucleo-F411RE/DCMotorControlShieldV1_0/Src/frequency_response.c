@@ -0,0 +1,365 @@
+/**
+ ******************************************************************************
+ * @file    frequency_response.c
+ * @brief   Source file of on-device frequency response analyzer (swept sine and PRBS excitation)
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "frequency_response.h"
+#include "stm32f4xx.h"  // __DMB
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define FRA_PI              3.14159265f
+#define FRA_MIN_PERIOD      3           ///< Minimum samples per cycle of swept sine
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+// Feedback masks of maximum length Galois LFSR (index : order - FRA_PRBS_MIN_ORDER)
+static const uint32_t LFSRMasks[FRA_PRBS_MAX_ORDER - FRA_PRBS_MIN_ORDER + 1] = {
+    0x0014, 0x0030, 0x0060, 0x00B8, 0x0110, 0x0240, 0x0500, 0x0829, 0x100D, 0x2015, 0x6000, 0xD008
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static inline void setFRABinFrequency(FRABin*, float, float);
+static inline void updateSweptSineFRA(FRA*, float, float);
+static inline void updatePRBSFRA(FRA*, float, float);
+static inline void calcPRBSSpectrum(const FRA*, const float*, const FRABin*, float*, float*);
+static inline void finishFRA(FRA*);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialize analyzer with swept sine excitation
+ * @details     Bins are spaced logarithmically. Bins whose snapped period is equal to the previous bin are skipped.
+ * @param[out]  pFRA Pointer of analyzer
+ * @param[in]   Amplitude Amplitude of excitation
+ * @param[in]   MinFrequency Frequency of the first bin [Hz]
+ * @param[in]   MaxFrequency Frequency of the last bin [Hz]
+ * @param[in]   NumBins Number of bins (1 ~ FRA_MAX_BINS)
+ * @param[in]   Cycles Measured cycles of each bin
+ * @param[in]   Ts Sampling time [s]
+ * @retval      0 : OK
+ * @retval      -1 : Invalid parameter
+*/
+int initSweptSineFRA(FRA* pFRA, float Amplitude, float MinFrequency, float MaxFrequency, uint32_t NumBins,
+        uint32_t Cycles, float Ts)
+{
+    if ((NumBins == 0) || (NumBins > FRA_MAX_BINS) || (Cycles == 0) || (MinFrequency <= 0.0f)
+            || (MaxFrequency < MinFrequency) || (MaxFrequency * Ts * FRA_MIN_PERIOD > 1.0f))
+        return -1;
+
+    pFRA->Status = Idle_FRAStatus;
+    pFRA->Excitation = SweptSine_Excitation;
+    pFRA->Amplitude = Amplitude;
+    pFRA->Ts = Ts;
+    pFRA->MeasureCycles = Cycles;
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < NumBins; i++) {
+        float Frequency = (NumBins > 1) ? MinFrequency * powf(MaxFrequency / MinFrequency, (float) i / (float) (NumBins - 1))
+                                        : MinFrequency;
+        uint32_t Period = (uint32_t) (1.0f / (Frequency * Ts) + 0.5f);
+        if ((n > 0) && (Period >= pFRA->Bins[n - 1].Period))
+            continue;
+        pFRA->Bins[n].Period = Period;
+        setFRABinFrequency(&pFRA->Bins[n], 1.0f / (float) Period, Ts);
+        n++;
+    }
+    pFRA->NumBins = n;
+    return 0;
+}
+
+/**
+ * @brief       Initialize analyzer with PRBS excitation
+ * @details     Bins are harmonics of the PRBS period spaced logarithmically up to 1/3 of the bit rate,
+ *              where the spectrum of PRBS is about 1.7[dB] lower than DC.
+ * @param[out]  pFRA Pointer of analyzer
+ * @param[in]   Amplitude Amplitude of excitation (output is +Amplitude or -Amplitude)
+ * @param[in]   Order Order of PRBS (FRA_PRBS_MIN_ORDER ~ FRA_PRBS_MAX_ORDER)
+ * @param[in]   Hold Samples per bit (lowers the frequency range), (2^Order - 1) * Hold is FRA_PRBS_MAX_LENGTH at most
+ * @param[in]   Periods Measured periods
+ * @param[in]   NumBins Maximum number of bins (1 ~ FRA_MAX_BINS)
+ * @param[in]   Ts Sampling time [s]
+ * @retval      0 : OK
+ * @retval      -1 : Invalid parameter
+*/
+int initPRBSFRA(FRA* pFRA, float Amplitude, uint32_t Order, uint32_t Hold, uint32_t Periods, uint32_t NumBins, float Ts)
+{
+    if ((Order < FRA_PRBS_MIN_ORDER) || (Order > FRA_PRBS_MAX_ORDER) || (Hold == 0) || (Periods == 0)
+            || (NumBins == 0) || (NumBins > FRA_MAX_BINS) || (((1UL << Order) - 1) * Hold > FRA_PRBS_MAX_LENGTH))
+        return -1;
+
+    pFRA->Status = Idle_FRAStatus;
+    pFRA->Excitation = PRBS_Excitation;
+    pFRA->Amplitude = Amplitude;
+    pFRA->Ts = Ts;
+    pFRA->MeasureCycles = Periods;
+    pFRA->PRBSHold = Hold;
+    pFRA->PRBSLength = ((1UL << Order) - 1) * Hold;
+    pFRA->LFSRMask = LFSRMasks[Order - FRA_PRBS_MIN_ORDER];
+
+    uint32_t MaxHarmonic = ((1UL << Order) - 1) / 3;
+    uint32_t Harmonic = 0, n = 0;
+    for (uint32_t i = 0; i < NumBins; i++) {
+        uint32_t Next = (NumBins > 1) ? (uint32_t) (powf((float) MaxHarmonic, (float) i / (float) (NumBins - 1)) + 0.5f) : 1;
+        if (Next <= Harmonic)
+            Next = Harmonic + 1;
+        if (Next > MaxHarmonic)
+            break;
+        Harmonic = Next;
+        pFRA->Bins[n].Period = 0;
+        setFRABinFrequency(&pFRA->Bins[n], (float) Harmonic / (float) pFRA->PRBSLength, Ts);
+        n++;
+    }
+    pFRA->NumBins = n;
+    return 0;
+}
+
+/**
+ * @brief       Start excitation and measurement
+ * @note        Call only when the analyzer is not running (the control loop accesses it only while running).
+ * @param[in,out] pFRA Pointer of initialized analyzer
+*/
+void startFRA(FRA* pFRA)
+{
+    for (uint32_t i = 0; i < pFRA->NumBins; i++) {
+        FRABin* pBin = &pFRA->Bins[i];
+        pBin->InputRe = pBin->InputIm = pBin->OutputRe = pBin->OutputIm = 0.0f;
+    }
+    if (pFRA->Excitation == PRBS_Excitation) {
+        for (uint32_t i = 0; i < pFRA->PRBSLength; i++)
+            pFRA->PRBSInput[i] = pFRA->PRBSOutput[i] = 0.0f;
+    }
+    pFRA->BinIndex = 0;
+    pFRA->SampleCount = 0;
+    pFRA->CycleCount = 0;
+    pFRA->PhasorCos = 1.0f;
+    pFRA->PhasorSin = 0.0f;
+    pFRA->LFSR = 1;
+
+    // Publish the configuration before the control loop starts to use it
+    __DMB();
+    pFRA->Status = (pFRA->NumBins > 0) ? Settling_FRAStatus : Finished_FRAStatus;
+}
+
+/**
+ * @brief       Stop excitation (result is discarded)
+ * @param[in,out] pFRA Pointer of analyzer
+*/
+void stopFRA(FRA* pFRA)
+{
+    pFRA->Status = Idle_FRAStatus;
+}
+
+/**
+ * @brief       Excitation of the present sampling period
+ * @param[in]   pFRA Pointer of analyzer
+ * @return      Excitation to be added to the injection point (0 if not running)
+*/
+float calcFRAExcitation(const FRA* pFRA)
+{
+    if (!isFRARunning(pFRA))
+        return 0.0f;
+    if (pFRA->Excitation == SweptSine_Excitation)
+        return pFRA->Amplitude * pFRA->PhasorSin;
+    return (pFRA->LFSR & 1) ? pFRA->Amplitude : -pFRA->Amplitude;
+}
+
+/**
+ * @brief       Correlate signals of the present sampling period and advance excitation
+ * @param[in,out] pFRA Pointer of analyzer
+ * @param[in]   Input Signal after the injection point (including excitation)
+ * @param[in]   Output Response
+*/
+void updateFRA(FRA* pFRA, float Input, float Output)
+{
+    if (!isFRARunning(pFRA))
+        return;
+    if (pFRA->Excitation == SweptSine_Excitation)
+        updateSweptSineFRA(pFRA, Input, Output);
+    else
+        updatePRBSFRA(pFRA, Input, Output);
+}
+
+/**
+ * @brief       Get frequency response of one bin (Output/Input)
+ * @note        With PRBS excitation, the spectrum of the bin is calculated here (call from a low priority task).
+ * @param[in]   pFRA Pointer of finished analyzer
+ * @param[in]   Index Index of bin
+ * @param[out]  pFrequency Frequency [Hz]
+ * @param[out]  pGain Gain [dB]
+ * @param[out]  pPhase Phase [deg]
+ * @retval      0 : OK
+ * @retval      -1 : Not finished, index out of range or no excitation in Input
+*/
+int getFRAResult(const FRA* pFRA, uint32_t Index, float* pFrequency, float* pGain, float* pPhase)
+{
+    if ((pFRA->Status != Finished_FRAStatus) || (Index >= pFRA->NumBins))
+        return -1;
+
+    const FRABin* pBin = &pFRA->Bins[Index];
+    float InputRe, InputIm, OutputRe, OutputIm;
+    if (pFRA->Excitation == PRBS_Excitation) {
+        calcPRBSSpectrum(pFRA, pFRA->PRBSInput, pBin, &InputRe, &InputIm);
+        calcPRBSSpectrum(pFRA, pFRA->PRBSOutput, pBin, &OutputRe, &OutputIm);
+    } else {
+        InputRe = pBin->InputRe;
+        InputIm = pBin->InputIm;
+        OutputRe = pBin->OutputRe;
+        OutputIm = pBin->OutputIm;
+    }
+    float InputPower = InputRe * InputRe + InputIm * InputIm;
+    if (InputPower <= 0.0f)
+        return -1;
+
+    // Output/Input
+    float Re = (OutputRe * InputRe + OutputIm * InputIm) / InputPower;
+    float Im = (OutputIm * InputRe - OutputRe * InputIm) / InputPower;
+
+    *pFrequency = pBin->Frequency;
+    *pGain = 10.0f * log10f(Re * Re + Im * Im);
+    *pPhase = atan2f(Im, Re) * (180.0f / FRA_PI);
+    return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Set frequency of bin
+ * @param[out]  pBin Pointer of bin
+ * @param[in]   CyclesPerSample Normalized frequency [cycle/sample]
+ * @param[in]   Ts Sampling time [s]
+*/
+static inline void setFRABinFrequency(FRABin* pBin, float CyclesPerSample, float Ts)
+{
+    float Omega = 2.0f * FRA_PI * CyclesPerSample;
+    pBin->Frequency = CyclesPerSample / Ts;
+    pBin->Cos = cosf(Omega);
+    pBin->Sin = sinf(Omega);
+}
+
+/**
+ * @brief       Swept sine : correlate with excitation phasor (DFT of the present bin)
+ * @param[in,out] pFRA Pointer of analyzer
+ * @param[in]   Input Signal after the injection point
+ * @param[in]   Output Response
+*/
+static inline void updateSweptSineFRA(FRA* pFRA, float Input, float Output)
+{
+    FRABin* pBin = &pFRA->Bins[pFRA->BinIndex];
+
+    if (pFRA->Status == Measuring_FRAStatus) {
+        // X += x[n]*exp(-j*w*n)
+        pBin->InputRe += Input * pFRA->PhasorCos;
+        pBin->InputIm -= Input * pFRA->PhasorSin;
+        pBin->OutputRe += Output * pFRA->PhasorCos;
+        pBin->OutputIm -= Output * pFRA->PhasorSin;
+    }
+
+    if (++pFRA->SampleCount < pBin->Period) {
+        float Cos = pFRA->PhasorCos;
+        pFRA->PhasorCos = Cos * pBin->Cos - pFRA->PhasorSin * pBin->Sin;
+        pFRA->PhasorSin = pFRA->PhasorSin * pBin->Cos + Cos * pBin->Sin;
+        return;
+    }
+
+    // End of one cycle (phasor is resynchronized every cycle, so rounding error does not accumulate)
+    pFRA->SampleCount = 0;
+    pFRA->PhasorCos = 1.0f;
+    pFRA->PhasorSin = 0.0f;
+    pFRA->CycleCount++;
+    if ((pFRA->Status == Settling_FRAStatus) && (pFRA->CycleCount >= FRA_SETTLE_CYCLES)) {
+        pFRA->Status = Measuring_FRAStatus;
+        pFRA->CycleCount = 0;
+    } else if ((pFRA->Status == Measuring_FRAStatus) && (pFRA->CycleCount >= pFRA->MeasureCycles)) {
+        pFRA->CycleCount = 0;
+        if (++pFRA->BinIndex >= pFRA->NumBins)
+            finishFRA(pFRA);
+        else
+            pFRA->Status = Settling_FRAStatus;
+    }
+}
+
+/**
+ * @brief       PRBS : sum signals at each sample of the period (synchronous averaging)
+ * @param[in,out] pFRA Pointer of analyzer
+ * @param[in]   Input Signal after the injection point
+ * @param[in]   Output Response
+*/
+static inline void updatePRBSFRA(FRA* pFRA, float Input, float Output)
+{
+    bool isMeasuring = (pFRA->Status == Measuring_FRAStatus);
+
+    if (isMeasuring) {
+        pFRA->PRBSInput[pFRA->SampleCount] += Input;
+        pFRA->PRBSOutput[pFRA->SampleCount] += Output;
+    }
+
+    // Next bit
+    pFRA->SampleCount++;
+    if ((pFRA->SampleCount % pFRA->PRBSHold) == 0)
+        pFRA->LFSR = (pFRA->LFSR >> 1) ^ ((pFRA->LFSR & 1) ? pFRA->LFSRMask : 0);
+    if (pFRA->SampleCount < pFRA->PRBSLength)
+        return;
+
+    // End of one period (LFSR has returned to the initial value)
+    pFRA->SampleCount = 0;
+    pFRA->CycleCount++;
+    if (!isMeasuring) {
+        pFRA->Status = Measuring_FRAStatus;     // One period for settling
+        pFRA->CycleCount = 0;
+    } else if (pFRA->CycleCount >= pFRA->MeasureCycles) {
+        finishFRA(pFRA);
+    }
+}
+
+/**
+ * @brief       PRBS : spectrum of one bin of the summed period by Goertzel algorithm
+ * @note        Common phase factor of Goertzel algorithm is cancelled by Output/Input.
+ * @param[in]   pFRA Pointer of analyzer
+ * @param[in]   pSamples Summed period (PRBSInput or PRBSOutput)
+ * @param[in]   pBin Pointer of bin
+ * @param[out]  pRe Real part
+ * @param[out]  pIm Imaginary part
+*/
+static inline void calcPRBSSpectrum(const FRA* pFRA, const float* pSamples, const FRABin* pBin, float* pRe, float* pIm)
+{
+    float Coeff = 2.0f * pBin->Cos;
+    float s1 = 0.0f, s2 = 0.0f;
+
+    for (uint32_t n = 0; n < pFRA->PRBSLength; n++) {
+        float s = pSamples[n] + Coeff * s1 - s2;
+        s2 = s1;
+        s1 = s;
+    }
+    *pRe = s1 - pBin->Cos * s2;
+    *pIm = pBin->Sin * s2;
+}
+
+/**
+ * @brief       Finish measurement
+ * @param[in,out] pFRA Pointer of analyzer
+*/
+static inline void finishFRA(FRA* pFRA)
+{
+    // Result is stored before it is published to the reader
+    __DMB();
+    pFRA->Status = Finished_FRAStatus;
+}
+
+/***************************************************************END OF FILE****/
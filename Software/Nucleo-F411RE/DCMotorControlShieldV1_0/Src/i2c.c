@@ -54,7 +54,11 @@
 #include "dma.h"
 
 /* USER CODE BEGIN 0 */
+#define I2C1_RECOVERY_CLOCKS    9   // Clocks until the slave releases SDA (8 data bits and ACK)
+#define I2C1_RECOVERY_STOP_STEP (1 + 2 * I2C1_RECOVERY_CLOCKS)
+#define I2C1_RECOVERY_DELAY     200 // Busy loop between steps of I2C1_SoftReset (more than half period of 100[kHz])
 
+static void I2C1_ConfigRecoveryPins(uint32_t);
 /* USER CODE END 0 */
 
 I2C_HandleTypeDef hi2c1;
@@ -125,9 +129,9 @@ void HAL_I2C_MspInit(I2C_HandleTypeDef* i2cHandle)
     __HAL_LINKDMA(i2cHandle,hdmarx,hdma_i2c1_rx);
 
     /* I2C1 interrupt Init */
-    HAL_NVIC_SetPriority(I2C1_EV_IRQn, 5, 0);
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, 6, 0);
     HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
-    HAL_NVIC_SetPriority(I2C1_ER_IRQn, 5, 0);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, 6, 0);
     HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
   /* USER CODE BEGIN I2C1_MspInit 1 */
 
@@ -174,15 +178,6 @@ void HAL_I2C_MspDeInit(I2C_HandleTypeDef* i2cHandle)
 } 
 
 /* USER CODE BEGIN 1 */
-void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
-{
-    if (hi2c->Instance == I2C1) {
-        I2C1_MemRxCpltCallback(hi2c);
-    } else {
-
-    }
-}
-
 /*
 void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
 {
@@ -194,36 +189,79 @@ void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
 }
 */
 
+/**
+  * @brief  Recover I2C1 bus held by a slave (blocking, used by HAL_I2C_MspInit)
+  */
 void I2C1_SoftReset(void)
 {
-    GPIO_InitTypeDef GPIO_InitStruct;
+    uint32_t Step = 0;
 
-    // SDA pin (PB9) input and check if High
-    GPIO_InitStruct.Pin = I2C_SDA_Pin;
-    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
-    GPIO_InitStruct.Pull = GPIO_PULLUP;
-    GPIO_InitStruct.Speed = GPIO_SPEED_FAST;
-    HAL_GPIO_Init(I2C_SDA_GPIO_Port, &GPIO_InitStruct);
-    if (HAL_GPIO_ReadPin(I2C_SDA_GPIO_Port, I2C_SDA_Pin) == GPIO_PIN_RESET)
-    {
-        printf("I2C error : SDA pin is LOW\r\n");
-        // SCK pin (PB8) output and send 9 dummy clock
-        GPIO_InitStruct.Pin = I2C_SCL_Pin;
-        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
-        GPIO_InitStruct.Pull = GPIO_PULLUP;
-        GPIO_InitStruct.Speed = GPIO_SPEED_FAST;
-        HAL_GPIO_Init(I2C_SCL_GPIO_Port, &GPIO_InitStruct);
-        HAL_GPIO_WritePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin, GPIO_PIN_SET);
+    while (!I2C1_RecoverBusStep(&Step)) {
+        for (volatile uint32_t i = 0; i < I2C1_RECOVERY_DELAY; i++);
+    }
+}
+
+/**
+  * @brief  Execute one step of I2C1 bus recovery by GPIO
+  * @note   Each call changes SCL or SDA once, so the recovery can be spread over periodic calls without blocking.
+  *         Up to 9 clocks are sent on SCL until the slave releases SDA, then STOP is generated.
+  *         I2C1 must be disabled (PE = 0) until the recovery finishes, then the pins are returned to I2C1.
+  * @param  pStep Pointer of step (0 to start)
+  * @retval true : Recovery finished (SDA may still be held if the slave does not respond)
+  * @retval false : In progress
+  */
+bool I2C1_RecoverBusStep(uint32_t* pStep)
+{
+    uint32_t Step = *pStep;
 
-        //for(uint8_t i = 0; i < (9 * 2); i++)
-        while (1)
-        {
-            HAL_GPIO_TogglePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin);
-            //HAL_Delay(1);
-            if (HAL_GPIO_ReadPin(I2C_SCL_GPIO_Port, I2C_SCL_Pin) == GPIO_PIN_SET)
-                break;
+    if (Step == 0) {
+        // Release both lines
+        HAL_GPIO_WritePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin | I2C_SDA_Pin, GPIO_PIN_SET);
+        I2C1_ConfigRecoveryPins(GPIO_MODE_OUTPUT_OD);
+        Step = 1;
+    } else if (Step < I2C1_RECOVERY_STOP_STEP) {
+        if (Step & 1) {
+            // SCL is high, clocks are no longer needed when SDA is released
+            if (HAL_GPIO_ReadPin(I2C_SDA_GPIO_Port, I2C_SDA_Pin) == GPIO_PIN_SET)
+                Step = I2C1_RECOVERY_STOP_STEP - 1;
+            else
+                HAL_GPIO_WritePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin, GPIO_PIN_RESET);
+        } else {
+            HAL_GPIO_WritePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin, GPIO_PIN_SET);
         }
+        Step++;
+    } else if (Step == I2C1_RECOVERY_STOP_STEP) {
+        // STOP : SDA rises while SCL is high
+        HAL_GPIO_WritePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin, GPIO_PIN_RESET);
+        HAL_GPIO_WritePin(I2C_SDA_GPIO_Port, I2C_SDA_Pin, GPIO_PIN_RESET);
+        Step++;
+    } else if (Step == I2C1_RECOVERY_STOP_STEP + 1) {
+        HAL_GPIO_WritePin(I2C_SCL_GPIO_Port, I2C_SCL_Pin, GPIO_PIN_SET);
+        Step++;
+    } else {
+        HAL_GPIO_WritePin(I2C_SDA_GPIO_Port, I2C_SDA_Pin, GPIO_PIN_SET);
+        I2C1_ConfigRecoveryPins(GPIO_MODE_AF_OD);
+        *pStep = 0;
+        return true;
     }
+    *pStep = Step;
+    return false;
+}
+
+/**
+  * @brief  Configure SCL and SDA pins
+  * @param  Mode GPIO_MODE_OUTPUT_OD : Driven by GPIO, GPIO_MODE_AF_OD : Driven by I2C1
+  */
+static void I2C1_ConfigRecoveryPins(uint32_t Mode)
+{
+    GPIO_InitTypeDef GPIO_InitStruct;
+
+    GPIO_InitStruct.Pin = I2C_SCL_Pin|I2C_SDA_Pin;
+    GPIO_InitStruct.Mode = Mode;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    GPIO_InitStruct.Alternate = GPIO_AF4_I2C1;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 }
 /* USER CODE END 1 */
 
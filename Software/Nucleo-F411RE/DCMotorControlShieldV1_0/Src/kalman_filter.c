@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file    kalman_filter.c
+ * @brief   Source file of steady-state Kalman filter for position, velocity and disturbance
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "kalman_filter.h"
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Reset Kalman filter (restarted from the next measurement with velocity and disturbance 0)
+ * @param[in,out] pKF Pointer of Kalman filter
+*/
+void resetKalmanFilter(KalmanFilter* pKF)
+{
+    pKF->Velocity = 0.0f;
+    pKF->Disturbance = 0.0f;
+    pKF->isInitialized = false;
+}
+
+/**
+ * @brief       Correct the state by measured position and predict the state of the present sampling period
+ * @param[in]   pCoeffs Pointer of coefficients
+ * @param[in,out] pKF Pointer of Kalman filter
+ * @param[in]   Position Measured position (measured in the previous sampling period) [rad]
+ * @param[in]   Timestamp Timestamp of the measurement (correction is skipped if it is not changed)
+ * @param[in]   Current Current response in the previous sampling period [A]
+*/
+void calcKalmanFilter(const KalmanCoeffs* pCoeffs, KalmanFilter* pKF, float Position, uint32_t Timestamp, float Current)
+{
+    if (!pKF->isInitialized) {
+        pKF->Position = Position;
+        pKF->PrevTimestamp = Timestamp;
+        pKF->isInitialized = true;
+    } else if (Timestamp != pKF->PrevTimestamp) {
+        // Correction (the state predicted in the previous call is the state when Position was measured)
+        float Err = Position - pKF->Position;
+        pKF->Position += pCoeffs->Lp * Err;
+        pKF->Velocity += pCoeffs->Lv * Err;
+        pKF->Disturbance += pCoeffs->Ld * Err;
+        pKF->PrevTimestamp = Timestamp;
+    }
+
+    // Prediction
+    float NetCurrent = Current - pKF->Disturbance;
+    pKF->Position += pCoeffs->Ts * pKF->Velocity + pCoeffs->Ts2b * NetCurrent;
+    pKF->Velocity += pCoeffs->Tsb * NetCurrent;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/***************************************************************END OF FILE****/
@@ -57,6 +57,7 @@
 #include "gpio.h"
 
 /* USER CODE BEGIN Includes */
+#include "profiler.h"
 //#define USE_MBED
 
 #ifdef USE_MBED
@@ -117,10 +118,12 @@ Skip_SystemClock_Config:
   MX_USART2_UART_Init();
   MX_I2C1_Init();
   MX_TIM3_Init();
+  MX_TIM4_Init();
   MX_ADC1_Init();
 
   /* USER CODE BEGIN 2 */
     printf("\r\n***** Program start *****\r\n");
+    PROFILER_INIT();
   /* USER CODE END 2 */
 
   /* Call init function for freertos objects (in freertos.c) */
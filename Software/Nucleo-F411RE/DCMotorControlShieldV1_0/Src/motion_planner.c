@@ -0,0 +1,330 @@
+/**
+ ******************************************************************************
+ * @file    motion_planner.c
+ * @brief   Source file of point-to-point motion planner
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "motion_planner.h"
+#include "stm32f4xx.h"
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define MOTION_QUEUE_MASK   (MOTION_QUEUE_SIZE - 1)
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static void planMove(MotionSegment*, float, float, float, float, float);
+static inline void appendPhase(MotionSegment*, float, float, MotionReference*, float*);
+static inline MotionSegment* beginEnqueue(MotionPlanner*);
+static inline void endEnqueue(MotionPlanner*, const MotionSegment*);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialize motion planner (call before producer and consumer start)
+ * @param[out]  pPlanner Pointer of motion planner
+ * @param[in]   Position Present position
+ * @param[in]   Ts Sampling time of consumer [s]
+*/
+void initMotionPlanner(MotionPlanner* pPlanner, float Position, float Ts)
+{
+    pPlanner->Head = 0;
+    pPlanner->Tail = 0;
+    pPlanner->Ts = Ts;
+    pPlanner->PlanPosition = Position;
+    pPlanner->ResetCountSeen = 0;
+    pPlanner->ResetCount = 0;
+    pPlanner->ResetPosition = Position;
+    pPlanner->HoldPosition = Position;
+    pPlanner->Tick = 0;
+    pPlanner->PhaseIndex = 0;
+}
+
+/**
+ * @brief       Plan a move from the target of previous segment and enqueue it (producer context)
+ * @param[in,out] pPlanner Pointer of motion planner
+ * @param[in]   Target Target position
+ * @param[in]   Vmax Maximum velocity (> 0)
+ * @param[in]   Amax Maximum acceleration (> 0)
+ * @param[in]   Jmax Maximum jerk (> 0 : S-curve, 0 : trapezoidal)
+ * @retval      0 : OK
+ * @retval      1 : Queue is full
+ * @retval      2 : Invalid parameter
+*/
+int enqueueMove(MotionPlanner* pPlanner, float Target, float Vmax, float Amax, float Jmax)
+{
+    if (!(Vmax > 0.0f) || !(Amax > 0.0f) || !(Jmax >= 0.0f))
+        return 2;
+
+    MotionSegment* pSeg = beginEnqueue(pPlanner);
+    if (pSeg == NULL)
+        return 1;
+
+    planMove(pSeg, pPlanner->PlanPosition, Target, Vmax, Amax, Jmax);
+    endEnqueue(pPlanner, pSeg);
+    return 0;
+}
+
+/**
+ * @brief       Enqueue a dwell at the target of previous segment (producer context)
+ * @param[in,out] pPlanner Pointer of motion planner
+ * @param[in]   Time Dwell time [s]
+ * @retval      0 : OK
+ * @retval      1 : Queue is full
+ * @retval      2 : Invalid parameter
+*/
+int enqueueDwell(MotionPlanner* pPlanner, float Time)
+{
+    if (!(Time >= 0.0f))
+        return 2;
+
+    MotionSegment* pSeg = beginEnqueue(pPlanner);
+    if (pSeg == NULL)
+        return 1;
+
+    MotionReference State = { pPlanner->PlanPosition, 0.0f, 0.0f };
+    float EndTime = 0.0f;
+    pSeg->NumPhases = 0;
+    appendPhase(pSeg, Time, 0.0f, &State, &EndTime);
+    pSeg->Duration = Time;
+    pSeg->Target = pPlanner->PlanPosition;
+    endEnqueue(pPlanner, pSeg);
+    return 0;
+}
+
+/**
+ * @brief       Get number of free segments in queue
+ * @param[in]   pPlanner Pointer of motion planner
+ * @return      Number of free segments
+*/
+uint32_t getMotionQueueSpace(const MotionPlanner* pPlanner)
+{
+    return MOTION_QUEUE_SIZE - (pPlanner->Head - pPlanner->Tail);
+}
+
+/**
+ * @brief       Advance motion planner and evaluate reference (consumer context)
+ * @param[in,out] pPlanner Pointer of motion planner
+ * @param[in]   nTicks Number of ticks elapsed since previous call (normally 1)
+ * @param[out]  pRef Pointer to store position, velocity and acceleration reference
+ * @retval      true : A segment is being executed
+ * @retval      false : Queue is empty (holding position)
+*/
+bool calcMotion(MotionPlanner* pPlanner, uint32_t nTicks, MotionReference* pRef)
+{
+    uint32_t Tail = pPlanner->Tail;
+
+    pPlanner->Tick += nTicks;
+    while (Tail != pPlanner->Head) {
+        __DMB();    // Read segment after Head
+        const MotionSegment* pSeg = &pPlanner->Queue[Tail & MOTION_QUEUE_MASK];
+        if (pSeg->ResetCount != pPlanner->ResetCount) {
+            // Planned from the position before resetMotion
+            pPlanner->Tail = ++Tail;
+            continue;
+        }
+        float t = (float) pPlanner->Tick * pPlanner->Ts;
+
+        if (t < pSeg->Duration) {
+            // Phases advance monotonically, so this loop is executed at most a few times per tick
+            while ((pPlanner->PhaseIndex + 1 < pSeg->NumPhases)
+                    && (t >= pSeg->Phases[pPlanner->PhaseIndex + 1].StartTime)) {
+                pPlanner->PhaseIndex++;
+            }
+            const MotionPhase* pPhase = &pSeg->Phases[pPlanner->PhaseIndex];
+            float tau = t - pPhase->StartTime;
+            pRef->Position = pPhase->Position
+                    + tau * (pPhase->Velocity + tau * (0.5f * pPhase->Acceleration + tau * (1.0f / 6.0f) * pPhase->Jerk));
+            pRef->Velocity = pPhase->Velocity + tau * (pPhase->Acceleration + tau * 0.5f * pPhase->Jerk);
+            pRef->Acceleration = pPhase->Acceleration + tau * pPhase->Jerk;
+            return true;
+        }
+
+        // Segment finished, next segment starts from the next tick
+        pPlanner->HoldPosition = pSeg->Target;
+        pPlanner->Tick = 0;
+        pPlanner->PhaseIndex = 0;
+        __DMB();    // Finish reading segment before releasing it
+        pPlanner->Tail = ++Tail;
+    }
+
+    pPlanner->Tick = 0;
+    pRef->Position = pPlanner->HoldPosition;
+    pRef->Velocity = 0.0f;
+    pRef->Acceleration = 0.0f;
+    return false;
+}
+
+/**
+ * @brief       Discard all segments and hold position (consumer context)
+ * @details     Producer plans the next segment from this position.
+ * @param[in,out] pPlanner Pointer of motion planner
+ * @param[in]   Position Hold position
+*/
+void resetMotion(MotionPlanner* pPlanner, float Position)
+{
+    pPlanner->Tail = pPlanner->Head;
+    pPlanner->Tick = 0;
+    pPlanner->PhaseIndex = 0;
+    pPlanner->HoldPosition = Position;
+    pPlanner->ResetPosition = Position;
+    __DMB();
+    pPlanner->ResetCount++;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Get free segment to plan (producer context)
+ * @param[in,out] pPlanner Pointer of motion planner
+ * @return      Pointer of free segment (NULL : queue is full)
+*/
+static inline MotionSegment* beginEnqueue(MotionPlanner* pPlanner)
+{
+    // Rebase planning position if consumer has been reset
+    uint32_t ResetCount = pPlanner->ResetCount;
+    if (ResetCount != pPlanner->ResetCountSeen) {
+        __DMB();
+        pPlanner->ResetCountSeen = ResetCount;
+        pPlanner->PlanPosition = pPlanner->ResetPosition;
+    }
+
+    if (getMotionQueueSpace(pPlanner) == 0)
+        return NULL;
+    MotionSegment* pSeg = &pPlanner->Queue[pPlanner->Head & MOTION_QUEUE_MASK];
+    pSeg->ResetCount = ResetCount;
+    return pSeg;
+}
+
+/**
+ * @brief       Publish planned segment (producer context)
+ * @param[in,out] pPlanner Pointer of motion planner
+ * @param[in]   pSeg Pointer of planned segment
+*/
+static inline void endEnqueue(MotionPlanner* pPlanner, const MotionSegment* pSeg)
+{
+    pPlanner->PlanPosition = pSeg->Target;
+    __DMB();    // Write segment before Head
+    pPlanner->Head++;
+}
+
+/**
+ * @brief       Plan rest-to-rest move
+ * @details     S-curve : jerk phases +J, 0, -J, 0 (cruise), -J, 0, +J.
+ *              Trapezoidal : acceleration phases +A, 0 (cruise), -A.
+ *              If the distance is too short, the peak velocity (and acceleration of S-curve) is reduced.
+ * @param[out]  pSeg Pointer of segment
+ * @param[in]   Start Start position
+ * @param[in]   Target Target position
+ * @param[in]   V Maximum velocity
+ * @param[in]   A Maximum acceleration
+ * @param[in]   J Maximum jerk (0 : trapezoidal)
+*/
+static void planMove(MotionSegment* pSeg, float Start, float Target, float V, float A, float J)
+{
+    const float D = fabsf(Target - Start);
+    const float Dir = (Target >= Start) ? 1.0f : -1.0f;
+    MotionReference State = { Start, 0.0f, 0.0f };
+    float EndTime = 0.0f;
+
+    pSeg->NumPhases = 0;
+    pSeg->Target = Target;
+
+    if (D == 0.0f) {
+        appendPhase(pSeg, 0.0f, 0.0f, &State, &EndTime);
+        pSeg->Duration = 0.0f;
+        return;
+    }
+
+    if (J > 0.0f) {
+        float Tj, Tac;
+        if (V * J < A * A) {
+            Tj = sqrtf(V / J);      // Acceleration does not reach A
+        } else {
+            Tj = A / J;
+        }
+        Tac = V / (J * Tj) - Tj;
+
+        if (V * (2.0f * Tj + Tac) > D) {
+            // Peak velocity is not reached
+            Tj = A / J;
+            V = 0.5f * A * (-Tj + sqrtf(Tj * Tj + 4.0f * D / A));
+            if (V * J < A * A) {
+                V = cbrtf(0.25f * D * D * J);
+                Tj = sqrtf(V / J);
+            }
+            Tac = fmaxf(V / (J * Tj) - Tj, 0.0f);
+        }
+        float Tv = fmaxf(D / V - (2.0f * Tj + Tac), 0.0f);
+
+        appendPhase(pSeg, Tj,  Dir * J, &State, &EndTime);
+        appendPhase(pSeg, Tac, 0.0f, &State, &EndTime);
+        appendPhase(pSeg, Tj, -Dir * J, &State, &EndTime);
+        appendPhase(pSeg, Tv,  0.0f, &State, &EndTime);
+        appendPhase(pSeg, Tj, -Dir * J, &State, &EndTime);
+        appendPhase(pSeg, Tac, 0.0f, &State, &EndTime);
+        appendPhase(pSeg, Tj,  Dir * J, &State, &EndTime);
+    } else {
+        if (V * V > D * A)
+            V = sqrtf(D * A);   // Peak velocity is not reached
+        float Ta = V / A;
+        float Tv = fmaxf(D / V - Ta, 0.0f);
+
+        // Constant acceleration phases are expressed with Jerk = 0 and initial acceleration
+        State.Acceleration = Dir * A;
+        appendPhase(pSeg, Ta, 0.0f, &State, &EndTime);
+        State.Acceleration = 0.0f;
+        appendPhase(pSeg, Tv, 0.0f, &State, &EndTime);
+        State.Acceleration = -Dir * A;
+        appendPhase(pSeg, Ta, 0.0f, &State, &EndTime);
+        State.Acceleration = 0.0f;
+    }
+    pSeg->Duration = EndTime;
+}
+
+/**
+ * @brief       Append constant jerk phase and integrate state to its end
+ * @param[in,out] pSeg Pointer of segment
+ * @param[in]   T Duration of phase [s] (phases of zero duration are not appended)
+ * @param[in]   Jerk Jerk
+ * @param[in,out] pState State at the beginning of phase (updated to the end of phase)
+ * @param[in,out] pTime Start time of phase (updated to the end of phase)
+*/
+static inline void appendPhase(MotionSegment* pSeg, float T, float Jerk, MotionReference* pState, float* pTime)
+{
+    if ((T <= 0.0f) && (pSeg->NumPhases != 0))
+        return;
+    if (pSeg->NumPhases >= MOTION_MAX_PHASES)
+        return;
+
+    MotionPhase* pPhase = &pSeg->Phases[pSeg->NumPhases++];
+    pPhase->StartTime = *pTime;
+    pPhase->Position = pState->Position;
+    pPhase->Velocity = pState->Velocity;
+    pPhase->Acceleration = pState->Acceleration;
+    pPhase->Jerk = Jerk;
+
+    pState->Position += T * (pState->Velocity + T * (0.5f * pState->Acceleration + T * (1.0f / 6.0f) * Jerk));
+    pState->Velocity += T * (pState->Acceleration + T * 0.5f * Jerk);
+    pState->Acceleration += T * Jerk;
+    *pTime += T;
+}
+
+/***************************************************************END OF FILE****/
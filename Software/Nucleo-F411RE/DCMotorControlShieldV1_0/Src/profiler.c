@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file    profiler.c
+ * @brief   Source file of loop profiler using DWT cycle counter
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "profiler.h"
+
+#if USE_LOOP_PROFILER
+#include "stm32f4xx.h"
+#include "control.h"
+
+// FreeRTOS
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Private function macro ----------------------------------------------------*/
+#define getCycleCount()     (DWT->CYCCNT)
+
+/* Private macro -------------------------------------------------------------*/
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/**
+ * @struct LoopProfile
+ * Execution time and release jitter statistics of one loop
+ */
+typedef struct
+{
+    uint32_t StartCycle;                        ///< Cycle count at the beginning of present execution
+    uint32_t PrevStartCycle;                    ///< Cycle count at the beginning of previous execution
+    bool     isPrevStartValid;                  ///< PrevStartCycle is the previous release (no release is skipped since then)
+    uint32_t Count;                             ///< Number of executions
+    uint32_t JitterCount;                       ///< Number of jitter samples
+    uint32_t ExecMin, ExecMax;                  ///< Min/Max execution time [cycle]
+    uint64_t ExecSum;                           ///< Sum of execution time [cycle]
+    int32_t  JitterMin, JitterMax;              ///< Min/Max release jitter [cycle]
+    int64_t  JitterSum;                         ///< Sum of release jitter [cycle]
+    uint32_t ExecHist[PROFILER_HIST_BINS];      ///< log2 histogram of execution time
+    uint32_t JitterHist[PROFILER_HIST_BINS];    ///< log2 histogram of absolute release jitter
+} LoopProfile;
+
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static volatile LoopProfile Profiles[Num_Profile];
+static uint32_t PeriodCycles[Num_Profile];    ///< Scheduled release period of each loop [cycle]
+
+static const char* const ProfileNames[Num_Profile] = {
+    "MajorControlLoop",
+    "MinorControlLoop",
+    "readPositionResponse",
+    "ADC1_ConvCpltCallback"
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static inline uint32_t getLog2Bin(uint32_t);
+static inline void clearProfile(ProfileId);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialize loop profiler and start DWT cycle counter
+*/
+void initProfiler(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    PeriodCycles[MajorControlLoop_Profile]      = (uint32_t) (SystemCoreClock * dt_major + 0.5f);
+    PeriodCycles[MinorControlLoop_Profile]      = (uint32_t) (SystemCoreClock * dt_minor + 0.5f);
+    PeriodCycles[ReadPositionResponse_Profile]  = (uint32_t) (SystemCoreClock * dt_major + 0.5f);
+    PeriodCycles[ADC1_ConvCpltCallback_Profile] = (uint32_t) (SystemCoreClock * dt_minor + 0.5f);
+
+    for (uint32_t id = 0; id < Num_Profile; id++)
+        clearProfile((ProfileId) id);
+}
+
+/**
+ * @brief       Mark the beginning of a profiled loop
+ * @details     Release jitter is measured only from the beginning of the previous release (see skipProfile).
+ * @param[in]   id Profile ID
+*/
+inline void beginProfile(ProfileId id)
+{
+    volatile LoopProfile* p = &Profiles[id];
+    uint32_t now = getCycleCount();
+
+    if (p->isPrevStartValid) {
+        int32_t jitter = (int32_t) (now - p->PrevStartCycle - PeriodCycles[id]);
+        uint32_t abs_jitter = (jitter < 0) ? (uint32_t) (-jitter) : (uint32_t) jitter;
+
+        if (jitter < p->JitterMin)
+            p->JitterMin = jitter;
+        if (jitter > p->JitterMax)
+            p->JitterMax = jitter;
+        p->JitterSum += jitter;
+        p->JitterHist[getLog2Bin(abs_jitter)]++;
+        p->JitterCount++;
+    }
+    p->PrevStartCycle = now;
+    p->isPrevStartValid = true;
+    p->StartCycle = now;
+}
+
+/**
+ * @brief       Mark the end of a profiled loop
+ * @param[in]   id Profile ID
+*/
+inline void endProfile(ProfileId id)
+{
+    volatile LoopProfile* p = &Profiles[id];
+    uint32_t exec = getCycleCount() - p->StartCycle;
+
+    if (exec < p->ExecMin)
+        p->ExecMin = exec;
+    if (exec > p->ExecMax)
+        p->ExecMax = exec;
+    p->ExecSum += exec;
+    p->ExecHist[getLog2Bin(exec)]++;
+    p->Count++;
+}
+
+/**
+ * @brief       Mark a release of a profiled loop which is not executed (skipped or missed)
+ * @details     The next beginning is not compared with the previous one, so the gap is not counted as jitter.
+ * @param[in]   id Profile ID
+*/
+inline void skipProfile(ProfileId id)
+{
+    Profiles[id].isPrevStartValid = false;
+}
+
+/**
+ * @brief       Output profile tables via UART
+*/
+void outputProfile(void)
+{
+    LoopProfile p;
+    const float cycle2us = 1000000.0f / (float) SystemCoreClock;
+
+    printf("Profile: SystemCoreClock %lu[Hz], histogram bin n : 2^(n-1) <= cycles < 2^n\r\n",
+            (unsigned long) SystemCoreClock);
+    for (uint32_t id = 0; id < Num_Profile; id++) {
+        taskENTER_CRITICAL();
+        memcpy(&p, (const void*) &Profiles[id], sizeof(p));
+        taskEXIT_CRITICAL();
+
+        printf("%s: count %lu\r\n", ProfileNames[id], (unsigned long) p.Count);
+        if (p.Count == 0)
+            continue;
+        printf(" exec[us] min %.2f, max %.2f, mean %.2f\r\n",
+                p.ExecMin * cycle2us, p.ExecMax * cycle2us, (float) p.ExecSum / (float) p.Count * cycle2us);
+        if (p.JitterCount != 0) {
+            printf(" jitter[us] min %.2f, max %.2f, mean %.2f\r\n",
+                    p.JitterMin * cycle2us, p.JitterMax * cycle2us, (float) p.JitterSum / (float) p.JitterCount * cycle2us);
+        }
+        printf(" exec hist:");
+        for (uint32_t i = 0; i < PROFILER_HIST_BINS; i++)
+            printf("%lu,", (unsigned long) p.ExecHist[i]);
+        printf("\r\n jitter hist:");
+        for (uint32_t i = 0; i < PROFILER_HIST_BINS; i++)
+            printf("%lu,", (unsigned long) p.JitterHist[i]);
+        printf("\r\n");
+    }
+}
+
+/**
+ * @brief       Reset all profile statistics
+*/
+void resetProfile(void)
+{
+    for (uint32_t id = 0; id < Num_Profile; id++) {
+        taskENTER_CRITICAL();
+        clearProfile((ProfileId) id);
+        taskEXIT_CRITICAL();
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Get log2 histogram bin of cycle count
+ * @param[in]   cycles Cycle count
+ * @return      Bin index (0 ~ PROFILER_HIST_BINS-1)
+*/
+static inline uint32_t getLog2Bin(uint32_t cycles)
+{
+    uint32_t bin = 32 - __CLZ(cycles);
+    return (bin < PROFILER_HIST_BINS) ? bin : (PROFILER_HIST_BINS - 1);
+}
+
+/**
+ * @brief       Clear statistics of one profile
+ * @param[in]   id Profile ID
+*/
+static inline void clearProfile(ProfileId id)
+{
+    memset((void*) &Profiles[id], 0, sizeof(LoopProfile));
+    Profiles[id].ExecMin = UINT32_MAX;
+    Profiles[id].JitterMin = INT32_MAX;
+    Profiles[id].JitterMax = INT32_MIN;
+}
+
+#endif /* USE_LOOP_PROFILER */
+/***************************************************************END OF FILE****/
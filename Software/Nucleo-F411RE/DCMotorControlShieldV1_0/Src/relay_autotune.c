@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************
+ * @file    relay_autotune.c
+ * @brief   Source file of relay feedback experiment for auto-tuning
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "relay_autotune.h"
+#include "stm32f4xx.h"  // __DMB
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define RELAY_PI    3.14159265f
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static inline void finishRelayExperiment(RelayExperiment*, RelayStatus);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Start relay feedback experiment
+ * @note        Call only when the experiment is not running (the control loop accesses it only while running).
+ * @param[out]  pRelay Pointer of experiment
+ * @param[in]   Amplitude Output amplitude of relay
+ * @param[in]   Hysteresis Hysteresis of relay (larger than noise of error)
+ * @param[in]   ErrorLimit Experiment fails if |error| exceeds this value
+ * @param[in]   Timeout Experiment fails if not finished within this time [s]
+ * @param[in]   Ts Sampling time [s]
+*/
+void startRelayExperiment(RelayExperiment* pRelay, float Amplitude, float Hysteresis, float ErrorLimit, float Timeout, float Ts)
+{
+    pRelay->Amplitude = Amplitude;
+    pRelay->Hysteresis = Hysteresis;
+    pRelay->ErrorLimit = ErrorLimit;
+    pRelay->Ts = Ts;
+    pRelay->Timeout = (uint32_t) (Timeout / Ts);
+
+    pRelay->Output = Amplitude;
+    pRelay->SampleCount = 0;
+    pRelay->LastRiseCount = 0;
+    pRelay->Cycles = 0;
+    pRelay->MaxErr = pRelay->MinErr = 0.0f;
+    pRelay->PeriodSum = 0;
+    pRelay->AmplitudeSum = 0.0f;
+    pRelay->UltimateGain = 0.0f;
+    pRelay->UltimatePeriod = 0.0f;
+
+    // Publish the configuration before the control loop starts to use it
+    __DMB();
+    pRelay->Status = Running_RelayStatus;
+}
+
+/**
+ * @brief       Stop relay feedback experiment (result is discarded)
+ * @param[in,out] pRelay Pointer of experiment
+*/
+void stopRelayExperiment(RelayExperiment* pRelay)
+{
+    pRelay->Status = Idle_RelayStatus;
+}
+
+/**
+ * @brief       Relay output of the present sampling period
+ * @param[in,out] pRelay Pointer of experiment
+ * @param[in]   Err Error of the loop (command - response)
+ * @return      Output which replaces the controller output (0 if not running)
+*/
+float calcRelayExperiment(RelayExperiment* pRelay, float Err)
+{
+    if (!isRelayExperimentRunning(pRelay))
+        return 0.0f;
+
+    if ((++pRelay->SampleCount >= pRelay->Timeout) || (Err > pRelay->ErrorLimit) || (Err < -pRelay->ErrorLimit)) {
+        finishRelayExperiment(pRelay, Failed_RelayStatus);
+        return 0.0f;
+    }
+
+    if (Err > pRelay->MaxErr)
+        pRelay->MaxErr = Err;
+    if (Err < pRelay->MinErr)
+        pRelay->MinErr = Err;
+
+    if ((pRelay->Output < 0.0f) && (Err > pRelay->Hysteresis)) {
+        pRelay->Output = pRelay->Amplitude;
+
+        // One cycle from the previous rising switch
+        if (pRelay->LastRiseCount > 0) {
+            if (pRelay->Cycles >= RELAY_SETTLE_CYCLES) {
+                pRelay->PeriodSum += pRelay->SampleCount - pRelay->LastRiseCount;
+                pRelay->AmplitudeSum += 0.5f * (pRelay->MaxErr - pRelay->MinErr);
+            }
+            if (++pRelay->Cycles >= RELAY_SETTLE_CYCLES + RELAY_MEASURE_CYCLES) {
+                float a = pRelay->AmplitudeSum / (float) RELAY_MEASURE_CYCLES;
+                float h = pRelay->Hysteresis;
+                if (a <= h) {
+                    finishRelayExperiment(pRelay, Failed_RelayStatus);
+                    return 0.0f;
+                }
+                pRelay->UltimateGain = 4.0f * pRelay->Amplitude / (RELAY_PI * sqrtf(a * a - h * h));
+                pRelay->UltimatePeriod = pRelay->Ts * (float) pRelay->PeriodSum / (float) RELAY_MEASURE_CYCLES;
+                finishRelayExperiment(pRelay, Finished_RelayStatus);
+                return 0.0f;
+            }
+        }
+        pRelay->LastRiseCount = pRelay->SampleCount;
+        pRelay->MaxErr = pRelay->MinErr = Err;
+    } else if ((pRelay->Output > 0.0f) && (Err < -pRelay->Hysteresis)) {
+        pRelay->Output = -pRelay->Amplitude;
+    }
+    return pRelay->Output;
+}
+
+/**
+ * @brief       Calculate PI gains from the result of relay feedback experiment
+ * @param[in]   pRelay Pointer of finished experiment
+ * @param[in]   Rule Tuning rule (TUNING_RULE_xxx)
+ * @param[out]  pKp Pointer of proportional gain
+ * @param[out]  pKi Pointer of integral gain
+ * @retval      0 : OK
+ * @retval      -1 : Experiment has not finished successfully
+*/
+int calcRelayTuningGains(const RelayExperiment* pRelay, int Rule, float* pKp, float* pKi)
+{
+    if (pRelay->Status != Finished_RelayStatus)
+        return -1;
+
+    float Ku = pRelay->UltimateGain, Tu = pRelay->UltimatePeriod;
+    switch (Rule) {
+        case TUNING_RULE_ZIEGLER_NICHOLS:
+            *pKp = 0.45f * Ku;
+            *pKi = *pKp / (Tu / 1.2f);
+            break;
+        case TUNING_RULE_TYREUS_LUYBEN:
+        default:
+            *pKp = Ku / 3.2f;
+            *pKi = *pKp / (2.2f * Tu);
+            break;
+    }
+    return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Finish relay feedback experiment
+ * @param[in,out] pRelay Pointer of experiment
+ * @param[in]   Status Finished or failed
+*/
+static inline void finishRelayExperiment(RelayExperiment* pRelay, RelayStatus Status)
+{
+    // Result is stored before it is published to the reader
+    __DMB();
+    pRelay->Status = Status;
+}
+
+/***************************************************************END OF FILE****/
@@ -0,0 +1,283 @@
+/**
+ ******************************************************************************
+ * @file    trajectory.c
+ * @brief   Source file of periodic trajectory source
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "trajectory.h"
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+#define PHASE_TO_RAD    (2.0f * (float) M_PI / 4294967296.0f)   ///< Phase accumulator to angle [rad]
+#define SINE_TABLE_BITS 8                                       ///< Number of bits of table index per quarter wave
+#define SINE_TABLE_SIZE (1U << SINE_TABLE_BITS)                 ///< Number of table entries per quarter wave
+#define SINE_Q          15                                      ///< Number of fractional bits of sine table
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+static int16_t SineTable[SINE_TABLE_SIZE + 1];  // Quarter wave of sine (Q15), filled by initTrajectoryCount
+static bool isSineTableReady = false;
+
+/* Private function prototypes -----------------------------------------------*/
+static void startSegment(TrajectorySource*);
+static void resyncPhasor(TrajectorySource*);
+static int32_t toCount(float);
+static inline int32_t calcSineCount(uint32_t);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialize trajectory source
+ * @param[out]  pSrc Pointer of trajectory source
+ * @param[in]   pSegments Pointer of segments (repeated periodically)
+ * @param[in]   NumSegments Number of segments
+ * @param[in]   Ts Sampling time [s]
+*/
+void initTrajectory(TrajectorySource* pSrc, const TrajectorySegment* pSegments, uint32_t NumSegments, float Ts)
+{
+    uint32_t Period = 0;
+
+    for (uint32_t i = 0; i < NumSegments; i++)
+        Period += pSegments[i].Duration;
+
+    pSrc->pSegments = pSegments;
+    pSrc->NumSegments = (Period != 0) ? NumSegments : 0;
+    pSrc->Ts = Ts;
+    pSrc->Index = 0;
+    pSrc->Tick = 0;
+    startSegment(pSrc);
+}
+
+/**
+ * @brief       Advance trajectory source and calculate command
+ * @param[in,out] pSrc Pointer of trajectory source
+ * @param[in]   nTicks Number of ticks elapsed since previous call (normally 1)
+ * @param[out]  pPosCmd Pointer to store position command
+ * @param[out]  pVelCmd Pointer to store velocity command
+ * @param[out]  pAccCmd Pointer to store acceleration command
+*/
+void calcTrajectory(TrajectorySource* pSrc, uint32_t nTicks, float* pPosCmd, float* pVelCmd, float* pAccCmd)
+{
+    if (pSrc->NumSegments == 0) {
+        *pPosCmd = 0.0f;
+        *pVelCmd = 0.0f;
+        *pAccCmd = 0.0f;
+        return;
+    }
+
+    // Advance integer time
+    pSrc->Tick += nTicks;
+    bool needsResync = (nTicks != 1);
+    while (pSrc->Tick >= pSrc->pSegments[pSrc->Index].Duration) {
+        pSrc->Tick -= pSrc->pSegments[pSrc->Index].Duration;
+        if (++pSrc->Index >= pSrc->NumSegments)
+            pSrc->Index = 0;
+        startSegment(pSrc);
+        needsResync = true;
+    }
+
+    const TrajectorySegment* pSeg = &pSrc->pSegments[pSrc->Index];
+    switch (pSeg->Type) {
+        case Sine_Segment:
+            if (needsResync || (pSrc->Tick % TRAJECTORY_RESYNC_TICKS) == 0) {
+                resyncPhasor(pSrc);
+            } else {
+                // Rotate phasor by one tick and correct its magnitude (first order approximation of 1/|phasor|)
+                float c = pSrc->Cos * pSrc->dCos - pSrc->Sin * pSrc->dSin;
+                float s = pSrc->Sin * pSrc->dCos + pSrc->Cos * pSrc->dSin;
+                float k = 1.5f - 0.5f * (c * c + s * s);
+                pSrc->Cos = c * k;
+                pSrc->Sin = s * k;
+            }
+            *pPosCmd = pSeg->Position + pSeg->Amplitude * pSrc->Sin;
+            *pVelCmd = pSeg->Amplitude * pSrc->Omega * pSrc->Cos;
+            *pAccCmd = -pSeg->Amplitude * pSrc->Omega2 * pSrc->Sin;
+            break;
+        case Hold_Segment:
+        default:
+            *pPosCmd = pSeg->Position;
+            *pVelCmd = 0.0f;
+            *pAccCmd = 0.0f;
+            break;
+    }
+}
+
+/**
+ * @brief       Initialize trajectory source in counts
+ * @details     Segments are converted into counts here, so calcTrajectoryCount needs no floating-point calculation.
+ * @param[out]  pSrc Pointer of trajectory source
+ * @param[in]   pSegments Pointer of segments (repeated periodically)
+ * @param[in]   NumSegments Number of segments (TRAJECTORY_MAX_SEGMENTS at most)
+ * @param[in]   Ts Sampling time [s]
+ * @param[in]   PositionPerCount Resolution of position [position unit/count]
+ * @retval      0 Success
+ * @retval      -1 Too many segments
+*/
+int initTrajectoryCount(TrajectoryCountSource* pSrc, const TrajectorySegment* pSegments, uint32_t NumSegments, float Ts, float PositionPerCount)
+{
+    uint32_t Period = 0;
+
+    pSrc->NumSegments = 0;
+    pSrc->Index = 0;
+    pSrc->Tick = 0;
+    if (NumSegments > TRAJECTORY_MAX_SEGMENTS)
+        return -1;
+
+    if (!isSineTableReady) {
+        for (uint32_t i = 0; i <= SINE_TABLE_SIZE; i++)
+            SineTable[i] = (int16_t) fminf(sinf(0.5f * (float) M_PI * (float) i / (float) SINE_TABLE_SIZE) * 32768.0f + 0.5f, 32767.0f);
+        isSineTableReady = true;
+    }
+
+    for (uint32_t i = 0; i < NumSegments; i++) {
+        const TrajectorySegment* pSeg = &pSegments[i];
+        TrajectoryCountSegment* pCountSeg = &pSrc->Segments[i];
+        float Omega = 2.0f * (float) M_PI * pSeg->Frequency;
+        float Amplitude = (pSeg->Type == Sine_Segment) ? pSeg->Amplitude / PositionPerCount : 0.0f;
+
+        pCountSeg->Type = pSeg->Type;
+        pCountSeg->Duration = pSeg->Duration;
+        pCountSeg->Position = toCount(pSeg->Position / PositionPerCount);
+        pCountSeg->Amplitude = toCount(Amplitude);
+        pCountSeg->VelAmplitude = toCount(Amplitude * Omega);
+        pCountSeg->AccAmplitude = toCount(Amplitude * Omega * Omega);
+        pCountSeg->PhaseStep = (pSeg->Type == Sine_Segment) ? (uint32_t) (int64_t) (pSeg->Frequency * Ts * 4294967296.0f + 0.5f) : 0;
+        Period += pSeg->Duration;
+    }
+    pSrc->NumSegments = (Period != 0) ? NumSegments : 0;
+    return 0;
+}
+
+/**
+ * @brief       Advance trajectory source in counts and calculate command (integer arithmetic only)
+ * @param[in,out] pSrc Pointer of trajectory source
+ * @param[in]   nTicks Number of ticks elapsed since previous call (normally 1)
+ * @param[out]  pPosCmd Pointer to store position command [count]
+ * @param[out]  pVelCmd Pointer to store velocity command [count/s]
+ * @param[out]  pAccCmd Pointer to store acceleration command [count/s^2]
+*/
+void calcTrajectoryCount(TrajectoryCountSource* pSrc, uint32_t nTicks, int32_t* pPosCmd, int32_t* pVelCmd, int32_t* pAccCmd)
+{
+    if (pSrc->NumSegments == 0) {
+        *pPosCmd = 0;
+        *pVelCmd = 0;
+        *pAccCmd = 0;
+        return;
+    }
+
+    // Advance integer time
+    pSrc->Tick += nTicks;
+    while (pSrc->Tick >= pSrc->Segments[pSrc->Index].Duration) {
+        pSrc->Tick -= pSrc->Segments[pSrc->Index].Duration;
+        if (++pSrc->Index >= pSrc->NumSegments)
+            pSrc->Index = 0;
+    }
+
+    const TrajectoryCountSegment* pSeg = &pSrc->Segments[pSrc->Index];
+    switch (pSeg->Type) {
+        case Sine_Segment: {
+            uint32_t Phase = pSrc->Tick * pSeg->PhaseStep;
+            int32_t Sin = calcSineCount(Phase);
+            int32_t Cos = calcSineCount(Phase + 0x40000000U);
+            *pPosCmd = pSeg->Position + (int32_t) (((int64_t) pSeg->Amplitude * Sin) >> SINE_Q);
+            *pVelCmd = (int32_t) (((int64_t) pSeg->VelAmplitude * Cos) >> SINE_Q);
+            *pAccCmd = (int32_t) (-(((int64_t) pSeg->AccAmplitude * Sin) >> SINE_Q));
+            break;
+        }
+        case Hold_Segment:
+        default:
+            *pPosCmd = pSeg->Position;
+            *pVelCmd = 0;
+            *pAccCmd = 0;
+            break;
+    }
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Prepare present segment (called only at segment change)
+ * @param[in,out] pSrc Pointer of trajectory source
+*/
+static void startSegment(TrajectorySource* pSrc)
+{
+    const TrajectorySegment* pSeg = &pSrc->pSegments[pSrc->Index];
+
+    if (pSeg->Type == Sine_Segment) {
+        float dPhase = pSeg->Frequency * pSrc->Ts;
+        pSrc->PhaseStep = (uint32_t) (int64_t) (dPhase * 4294967296.0f + 0.5f);
+        pSrc->Omega = 2.0f * (float) M_PI * pSeg->Frequency;
+        pSrc->Omega2 = pSrc->Omega * pSrc->Omega;
+        pSrc->dCos = cosf((float) pSrc->PhaseStep * PHASE_TO_RAD);
+        pSrc->dSin = sinf((float) pSrc->PhaseStep * PHASE_TO_RAD);
+    }
+    pSrc->Cos = 1.0f;
+    pSrc->Sin = 0.0f;
+}
+
+/**
+ * @brief       Recalculate phasor from integer time
+ * @details     Phase is Tick * PhaseStep (mod 2^32), so it is exact regardless of elapsed time.
+ * @param[in,out] pSrc Pointer of trajectory source
+*/
+static void resyncPhasor(TrajectorySource* pSrc)
+{
+    float Angle = (float) (pSrc->Tick * pSrc->PhaseStep) * PHASE_TO_RAD;
+
+    pSrc->Cos = cosf(Angle);
+    pSrc->Sin = sinf(Angle);
+}
+
+/**
+ * @brief       Convert value into count with rounding and saturation
+ * @param[in]   x Value [count]
+ * @return      Rounded value [count]
+*/
+static int32_t toCount(float x)
+{
+    if (x >= (float) INT32_MAX)
+        return INT32_MAX;
+    if (x <= (float) INT32_MIN)
+        return INT32_MIN;
+    return (int32_t) ((x >= 0.0f) ? (x + 0.5f) : (x - 0.5f));
+}
+
+/**
+ * @brief       Calculate sine from phase accumulator with quarter wave table and linear interpolation
+ * @param[in]   Phase Phase (2^32 = 1 cycle)
+ * @return      Sine of phase (Q15)
+*/
+static inline int32_t calcSineCount(uint32_t Phase)
+{
+    const uint32_t FracBits = 30 - SINE_TABLE_BITS;
+    uint32_t x = Phase & 0x3FFFFFFFU;   // Phase in quadrant (2^30 = pi/2)
+
+    if (Phase & 0x40000000U)
+        x = 0x40000000U - x;            // 2nd and 4th quadrants are mirrored
+    uint32_t i = x >> FracBits;
+    int32_t y = SineTable[i];
+    if (i < SINE_TABLE_SIZE)
+        y += ((SineTable[i + 1] - SineTable[i]) * (int32_t) (x & ((1U << FracBits) - 1))) >> FracBits;
+    return (Phase & 0x80000000U) ? -y : y;
+}
+
+/***************************************************************END OF FILE****/
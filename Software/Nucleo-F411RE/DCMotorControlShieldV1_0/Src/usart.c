@@ -142,6 +142,18 @@ int _write(int file, char *ptr, int len)
     return len;
 }
 
+/**
+ * @brief  Read one received character from the USART without blocking.
+ * @param  None
+ * @retval Received character, or -1 if no character has been received
+ */
+int readSerialChar(void)
+{
+    if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_RXNE) == RESET)
+        return -1;
+    return (int)(huart2.Instance->DR & 0xFF);
+}
+
 /* USER CODE END 1 */
 
 /**
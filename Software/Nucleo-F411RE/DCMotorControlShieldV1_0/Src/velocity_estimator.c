@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * @file    velocity_estimator.c
+ * @brief   Source file of velocity estimators using timestamped encoder samples
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "velocity_estimator.h"
+
+/* Private function macro ----------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+#define MT_EDGE_BUFFER_MASK     (MT_EDGE_BUFFER_SIZE - 1)
+
+/* Imported variables --------------------------------------------------------*/
+/* Private types -------------------------------------------------------------*/
+/* Private enum tag ----------------------------------------------------------*/
+/* Private struct/union tag --------------------------------------------------*/
+/* Exported variables --------------------------------------------------------*/
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+static inline void pushMTEdge(MTEstimator*, uint32_t, uint32_t);
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief       Initialize M/T method velocity estimator
+ * @param[out]  pEst Pointer of estimator
+ * @param[in]   Resolution Position per count [rad/count]
+ * @param[in]   TimestampFrequency Frequency of timestamp counter [Hz]
+ * @param[in]   MinWindow Minimum measurement window [s]
+*/
+void initMTEstimator(MTEstimator* pEst, float Resolution, float TimestampFrequency, float MinWindow)
+{
+    pEst->VelocityPerCountCycle = Resolution * TimestampFrequency;
+    pEst->MinWindow = (uint32_t) (MinWindow * TimestampFrequency);
+    pEst->Timeout = (uint32_t) (MT_ESTIMATOR_TIMEOUT * TimestampFrequency);
+    resetMTEstimator(pEst);
+}
+
+/**
+ * @brief       Reset M/T method velocity estimator (restarted from the next sample with velocity 0)
+ * @param[in,out] pEst Pointer of estimator
+*/
+void resetMTEstimator(MTEstimator* pEst)
+{
+    pEst->NumEdges = 0;
+    pEst->EdgeIndex = 0;
+    pEst->Velocity = 0.0f;
+    pEst->isInitialized = false;
+}
+
+/**
+ * @brief       M/T method velocity estimator
+ * @param[in,out] pEst Pointer of estimator
+ * @param[in]   Count Free-running encoder count (wraps around)
+ * @param[in]   Timestamp Time when the sample was received [cycle]
+ * @return      Velocity [rad/s]
+*/
+float calcMTEstimator(MTEstimator* pEst, uint32_t Count, uint32_t Timestamp)
+{
+    if (!pEst->isInitialized) {
+        pushMTEdge(pEst, Count, Timestamp);
+        pEst->PrevTimestamp = Timestamp;
+        pEst->isInitialized = true;
+        return pEst->Velocity;
+    }
+    if (Timestamp == pEst->PrevTimestamp)
+        return pEst->Velocity;  // No new sample
+    pEst->PrevTimestamp = Timestamp;
+
+    uint32_t Latest = (pEst->EdgeIndex - 1) & MT_EDGE_BUFFER_MASK;
+    if (Count != pEst->EdgeCount[Latest]) {
+        pushMTEdge(pEst, Count, Timestamp);
+
+        // Newest edge which is older than minimum window (or the oldest edge)
+        uint32_t Index = Latest;
+        for (uint32_t i = 1; i < pEst->NumEdges; i++) {
+            Index = (pEst->EdgeIndex - 1 - i) & MT_EDGE_BUFFER_MASK;
+            if (Timestamp - pEst->EdgeTime[Index] >= pEst->MinWindow)
+                break;
+        }
+        pEst->Velocity = pEst->VelocityPerCountCycle * (float) (int32_t) (Count - pEst->EdgeCount[Index])
+                / (float) (Timestamp - pEst->EdgeTime[Index]);
+    } else {
+        uint32_t Elapsed = Timestamp - pEst->EdgeTime[Latest];
+        if (Elapsed >= pEst->Timeout) {
+            pEst->Velocity = 0.0f;
+        } else {
+            // Count has not changed for Elapsed, so the speed is less than 1 count per Elapsed
+            float Bound = pEst->VelocityPerCountCycle / (float) Elapsed;
+            if (pEst->Velocity > Bound)
+                pEst->Velocity = Bound;
+            else if (pEst->Velocity < -Bound)
+                pEst->Velocity = -Bound;
+        }
+    }
+    return pEst->Velocity;
+}
+
+/**
+ * @brief       Initialize tracking loop (PLL) velocity estimator
+ * @param[out]  pEst Pointer of estimator
+ * @param[in]   Resolution Position per count [rad/count]
+ * @param[in]   TimestampFrequency Frequency of timestamp counter [Hz]
+ * @param[in]   Bandwidth Natural frequency of the loop (damping ratio is 1) [rad/s]
+*/
+void initPLLEstimator(PLLEstimator* pEst, float Resolution, float TimestampFrequency, float Bandwidth)
+{
+    pEst->Resolution = Resolution;
+    pEst->SecPerCycle = 1.0f / TimestampFrequency;
+    pEst->Kp = 2.0f * Bandwidth;
+    pEst->Ki = Bandwidth * Bandwidth;
+    pEst->MaxDt = 1.0f / pEst->Kp;
+    resetPLLEstimator(pEst);
+}
+
+/**
+ * @brief       Reset tracking loop (PLL) velocity estimator (restarted from the next sample with velocity 0)
+ * @param[in,out] pEst Pointer of estimator
+*/
+void resetPLLEstimator(PLLEstimator* pEst)
+{
+    pEst->Velocity = 0.0f;
+    pEst->isInitialized = false;
+}
+
+/**
+ * @brief       Tracking loop (PLL) velocity estimator
+ * @details     Estimated position is kept as integer and fractional part, so the precision does not depend on position.
+ * @param[in,out] pEst Pointer of estimator
+ * @param[in]   Count Free-running encoder count (wraps around)
+ * @param[in]   Timestamp Time when the sample was received [cycle]
+ * @return      Velocity [rad/s]
+*/
+float calcPLLEstimator(PLLEstimator* pEst, uint32_t Count, uint32_t Timestamp)
+{
+    if (!pEst->isInitialized) {
+        pEst->PositionCount = Count;
+        pEst->PositionFrac = 0.0f;
+        pEst->PrevTimestamp = Timestamp;
+        pEst->isInitialized = true;
+        return pEst->Resolution * pEst->Velocity;
+    }
+    if (Timestamp == pEst->PrevTimestamp)
+        return pEst->Resolution * pEst->Velocity;   // No new sample
+
+    float dt = pEst->SecPerCycle * (float) (Timestamp - pEst->PrevTimestamp);
+    pEst->PrevTimestamp = Timestamp;
+    if (dt > pEst->MaxDt) {
+        // Samples were lost, so restart tracking from this sample (velocity is kept)
+        pEst->PositionCount = Count;
+        pEst->PositionFrac = 0.0f;
+        return pEst->Resolution * pEst->Velocity;
+    }
+
+    // Predict position at sample time, then correct by the error
+    pEst->PositionFrac += pEst->Velocity * dt;
+    float Err = (float) (int32_t) (Count - pEst->PositionCount) - pEst->PositionFrac;
+    pEst->Velocity += pEst->Ki * dt * Err;
+    pEst->PositionFrac += pEst->Kp * dt * Err;
+
+    // Move integer part of the fraction
+    int32_t Carry = (int32_t) pEst->PositionFrac;
+    pEst->PositionCount += (uint32_t) Carry;
+    pEst->PositionFrac -= (float) Carry;
+
+    return pEst->Resolution * pEst->Velocity;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Store sample where the count changed
+ * @param[in,out] pEst Pointer of estimator
+ * @param[in]   Count Encoder count
+ * @param[in]   Timestamp Timestamp [cycle]
+*/
+static inline void pushMTEdge(MTEstimator* pEst, uint32_t Count, uint32_t Timestamp)
+{
+    uint32_t Index = pEst->EdgeIndex & MT_EDGE_BUFFER_MASK;
+    pEst->EdgeCount[Index] = Count;
+    pEst->EdgeTime[Index] = Timestamp;
+    pEst->EdgeIndex = (Index + 1) & MT_EDGE_BUFFER_MASK;
+    if (pEst->NumEdges < MT_EDGE_BUFFER_SIZE)
+        pEst->NumEdges++;
+}
+
+/***************************************************************END OF FILE****/
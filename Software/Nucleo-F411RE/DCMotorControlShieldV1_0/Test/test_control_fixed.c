@@ -0,0 +1,251 @@
+/**
+ ******************************************************************************
+ * @file    test_control_fixed.c
+ * @brief   Host test of fixed-point controller functions against floating-point controllers
+ * @details Checks Q7.24 scaling of toFixedGain/setFixedGains, and that the fixed-point position loop
+ *          (control_fixed.c, trajectory source in counts) follows the floating-point position loop (controller.h)
+ *          on the same double integrator plant. Build and run on the host (no device header is needed):
+ *
+ *          gcc -std=c11 -Wall -Wextra -IInc -o test_control_fixed Test/test_control_fixed.c Src/control_fixed.c Src/trajectory.c -lm
+ *          ./test_control_fixed
+ * @version 1.0
+ *
+ * @par License
+ *      This software is released under the MIT License, see LICENSE.txt.
+ * @par ChangeLog
+ * - 1.0 : Initial Version
+ ******************************************************************************
+ */
+
+/* Include system header files -----------------------------------------------*/
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/* Include user header files -------------------------------------------------*/
+#include "control.h"
+#include "controller.h"
+#include "control_fixed.h"
+#include "trajectory.h"
+
+/* Private function macro ----------------------------------------------------*/
+#define CHECK(cond, ...)                        \
+    do {                                        \
+        if (!(cond)) {                          \
+            printf("NG:%s:%d: ", __func__, __LINE__); \
+            printf(__VA_ARGS__);                \
+            printf("\n");                       \
+            Failures++;                         \
+        }                                       \
+    } while (0)
+
+/* Private macro -------------------------------------------------------------*/
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Resolutions of the shield (RotaryEncoder_AS5600.c, CurrentSenseAmp_INA181.c, adc.h)
+#define POSITION_PER_COUNT  (2.0f * (float) M_PI / 4096.0f)         ///< [rad/count]
+#define CURRENT_PER_COUNT   (3.3f / 4096.0f / 20.0f / 0.05f)        ///< [A/count]
+#define GAIN_SCALE          (POSITION_PER_COUNT * (Mn / Ktn) / CURRENT_PER_COUNT) ///< [current count/position count per rad/s^2/rad]
+
+#define SIM_TICKS           25000       ///< 5[s] of major loop periods (sine, holds and step)
+
+/* Private variables ---------------------------------------------------------*/
+static int Failures = 0;
+
+static const TrajectorySegment Segments[] = {
+    TRAJECTORY_SINE(SEC_TO_TICKS(1.0f, dt_major), 0.0f, 1.0f, 1.0f),
+    TRAJECTORY_HOLD(SEC_TO_TICKS(0.5f, dt_major), 0.0f),
+    TRAJECTORY_HOLD(SEC_TO_TICKS(0.5f, dt_major), 1.0f),
+    TRAJECTORY_HOLD(SEC_TO_TICKS(0.5f, dt_major), 0.0f),
+};
+#define NUM_SEGMENTS    (sizeof(Segments) / sizeof(Segments[0]))
+
+/* Private function prototypes -----------------------------------------------*/
+static void testFixedGainScaling(void);
+static void testPIDEquivalence(void);
+static void testTrajectoryEquivalence(void);
+static void testPositionLoopEquivalence(void);
+
+/* Exported functions --------------------------------------------------------*/
+int main(void)
+{
+    testFixedGainScaling();
+    testPIDEquivalence();
+    testTrajectoryEquivalence();
+    testPositionLoopEquivalence();
+
+    printf(Failures ? "NG:%d\n" : "OK\n", Failures);
+    return Failures ? 1 : 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+/**
+ * @brief       Q7.24 format of toFixedGain and setFixedGains
+*/
+static void testFixedGainScaling(void)
+{
+    CHECK(toFixedGain(1.0f) == (1L << FIXED_GAIN_Q), "1.0 -> %ld", (long) toFixedGain(1.0f));
+    CHECK(toFixedGain(-0.5f) == -(1L << (FIXED_GAIN_Q - 1)), "-0.5 -> %ld", (long) toFixedGain(-0.5f));
+    CHECK(toFixedGain(0.6f / (float) (1L << FIXED_GAIN_Q)) == 1, "LSB rounding");
+    CHECK(toFixedGain(-0.6f / (float) (1L << FIXED_GAIN_Q)) == -1, "LSB rounding (negative)");
+    CHECK(toFixedGain(127.5f) == (int32_t) (127.5 * (1L << FIXED_GAIN_Q)), "127.5 -> %ld", (long) toFixedGain(127.5f));
+    CHECK(toFixedGain(128.0f) == INT32_MAX, "Upper saturation");
+    CHECK(toFixedGain(-129.0f) == INT32_MIN, "Lower saturation");
+
+    // Gains of position and velocity loops in current count per position count
+    const float Gains[][3] = {
+        { Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT },
+        { Kp_v_DEFAULT, Ki_v_DEFAULT, 0.0f },
+    };
+    for (unsigned i = 0; i < sizeof(Gains) / sizeof(Gains[0]); i++) {
+        FixedGains g;
+        setFixedGains(&g, Gains[i][0], Gains[i][1], Gains[i][2], dt_major, GAIN_SCALE);
+        double q = (double) (1L << FIXED_GAIN_Q);
+        double Kp = (double) Gains[i][0] * GAIN_SCALE * q;
+        double KiTs = (double) Gains[i][1] * dt_major * GAIN_SCALE * q;
+        double Kd = (double) Gains[i][2] * GAIN_SCALE * q;
+        CHECK(fabs(g.Kp - Kp) <= 1.0 + 1e-6 * fabs(Kp), "Kp %ld (expected %.1f)", (long) g.Kp, Kp);
+        CHECK(fabs(g.KiTs - KiTs) <= 1.0 + 1e-6 * fabs(KiTs), "KiTs %ld (expected %.1f)", (long) g.KiTs, KiTs);
+        CHECK(fabs(g.Kd - Kd) <= 1.0 + 1e-6 * fabs(Kd), "Kd %ld (expected %.1f)", (long) g.Kd, Kd);
+        CHECK(g.KiTs > 0, "Integral gain vanished in Q7.24");
+    }
+}
+
+/**
+ * @brief       Fixed-point PID with anti-windup against calcPIDAntiWindup for the same error sequence
+*/
+static void testPIDEquivalence(void)
+{
+    PIDCoeffs Coeffs;
+    ControllerState State;
+    FixedGains Gains;
+    int32_t ErrInt = 0;
+    double MaxDiff = 0.0;
+
+    setPIDCoeffs(&Coeffs, Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT, dt_major);
+    resetController(&State, 0.0f, 0.0f);
+    setFixedGains(&Gains, Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT, dt_major, GAIN_SCALE);
+
+    for (int k = 0; k < 20000; k++) {
+        int32_t Err = (int32_t) lround(200.0 * sin(0.003 * k) + 30.0 * sin(0.11 * k));
+        int32_t dErr = (int32_t) lround(5000.0 * cos(0.007 * k));
+        int Saturation = ((k / 1000) % 3) - 1;     // Upper, none and lower in turn
+
+        float Out = calcPIDAntiWindup(&Coeffs, &State, POSITION_PER_COUNT * (float) Err,
+                POSITION_PER_COUNT * (float) dErr, Saturation) * (Mn / Ktn) / CURRENT_PER_COUNT;
+        int32_t OutCount = calcFixedPIDAntiWindup(&Gains, &ErrInt, Err, dErr, Saturation);
+
+        double Diff = fabs((double) OutCount - Out);
+        if (Diff > MaxDiff)
+            MaxDiff = Diff;
+        CHECK(Diff <= 1.0 + 1e-3 * fabs(Out), "k=%d fixed %ld float %.3f", k, (long) OutCount, Out);
+        if (Diff > 1.0 + 1e-3 * fabs(Out))
+            break;
+    }
+    printf("PID:MaxDiff:%.3f[count]\n", MaxDiff);
+}
+
+/**
+ * @brief       Trajectory source in counts against floating-point trajectory source
+*/
+static void testTrajectoryEquivalence(void)
+{
+    TrajectorySource Src;
+    TrajectoryCountSource CountSrc;
+    double MaxPosDiff = 0.0, MaxVelDiff = 0.0, MaxAccDiff = 0.0;
+
+    initTrajectory(&Src, Segments, NUM_SEGMENTS, dt_major);
+    CHECK(initTrajectoryCount(&CountSrc, Segments, NUM_SEGMENTS, dt_major, POSITION_PER_COUNT) == 0, "init");
+    CHECK(initTrajectoryCount(&CountSrc, Segments, TRAJECTORY_MAX_SEGMENTS + 1, dt_major, POSITION_PER_COUNT) == -1, "Too many segments");
+    CHECK(initTrajectoryCount(&CountSrc, Segments, NUM_SEGMENTS, dt_major, POSITION_PER_COUNT) == 0, "init");
+
+    for (int k = 0; k < 2 * SIM_TICKS; k++) {
+        float Pos, Vel, Acc;
+        int32_t PosCount, VelCount, AccCount;
+        uint32_t nTicks = (k % 997 == 0) ? 3 : 1;   // Missed periods
+
+        calcTrajectory(&Src, nTicks, &Pos, &Vel, &Acc);
+        calcTrajectoryCount(&CountSrc, nTicks, &PosCount, &VelCount, &AccCount);
+
+        double PosDiff = fabs(PosCount - Pos / POSITION_PER_COUNT);
+        double VelDiff = fabs(VelCount - Vel / POSITION_PER_COUNT);
+        double AccDiff = fabs(AccCount - Acc / POSITION_PER_COUNT);
+        MaxPosDiff = fmax(MaxPosDiff, PosDiff);
+        MaxVelDiff = fmax(MaxVelDiff, VelDiff);
+        MaxAccDiff = fmax(MaxAccDiff, AccDiff);
+    }
+    printf("Trajectory:MaxDiff:Pos:%.3f[count],Vel:%.3f[count/s],Acc:%.3f[count/s^2]\n", MaxPosDiff, MaxVelDiff, MaxAccDiff);
+    // Amplitudes are 652[count], 4096[count/s] and 25736[count/s^2]
+    CHECK(MaxPosDiff <= 1.5, "Position");
+    CHECK(MaxVelDiff <= 4096.0 * 1e-3, "Velocity");
+    CHECK(MaxAccDiff <= 25736.0 * 1e-3, "Acceleration");
+}
+
+/**
+ * @brief       Fixed-point and floating-point position loops on the same plant (current loop is ideal)
+*/
+static void testPositionLoopEquivalence(void)
+{
+    // Floating-point loop (control.c with USE_FIXED_POINT_CONTROL 0)
+    TrajectorySource Src;
+    PIDCoeffs PositionCoeffs;
+    PseudoDiffCoeffs VelocityResCoeffs;
+    ControllerState PositionState, VelocityResState;
+    double Pos = 0.0, Vel = 0.0;
+
+    // Fixed-point loop (control.c with USE_FIXED_POINT_CONTROL 1)
+    TrajectoryCountSource CountSrc;
+    FixedGains PositionGains;
+    FixedPseudoDifferential VelocityPD;
+    int32_t PositionErrIntCount = 0;
+    int32_t AccelerationGain = toFixedGain(GAIN_SCALE);
+    double PosFixed = 0.0, VelFixed = 0.0;
+
+    double MaxDiff = 0.0, MaxErr = 0.0;
+
+    initTrajectory(&Src, Segments, NUM_SEGMENTS, dt_major);
+    setPIDCoeffs(&PositionCoeffs, Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT, dt_major);
+    setPseudoDiffCoeffs(&VelocityResCoeffs, Gpd_DEFAULT, dt_major);
+    resetController(&PositionState, 0.0f, 0.0f);
+    resetController(&VelocityResState, 0.0f, 0.0f);
+
+    initTrajectoryCount(&CountSrc, Segments, NUM_SEGMENTS, dt_major, POSITION_PER_COUNT);
+    setFixedGains(&PositionGains, Kp_p_DEFAULT, Ki_p_DEFAULT, Kd_p_DEFAULT, dt_major, GAIN_SCALE);
+    initFixedPseudoDifferential(&VelocityPD, Gpd_DEFAULT, dt_major, 0);
+
+    for (int k = 0; k < SIM_TICKS; k++) {
+        // Floating-point
+        float PosCmd, VelCmd, AccCmd;
+        calcTrajectory(&Src, 1, &PosCmd, &VelCmd, &AccCmd);
+        float PositionRes = POSITION_PER_COUNT * (float) lround(Pos / POSITION_PER_COUNT);
+        float VelocityRes = calcPseudoDiff(&VelocityResCoeffs, &VelocityResState, PositionRes);
+        float AccelerationRef = calcPIDAntiWindup(&PositionCoeffs, &PositionState, PosCmd - PositionRes, VelCmd - VelocityRes, 0) + AccCmd;
+        // Current response is quantized by ADC as in fixed-point loop
+        double Current = CURRENT_PER_COUNT * lround(AccelerationRef * (Mn / Ktn) / CURRENT_PER_COUNT);
+
+        // Fixed-point
+        int32_t PosCmdCount, VelCmdCount, AccCmdCount;
+        calcTrajectoryCount(&CountSrc, 1, &PosCmdCount, &VelCmdCount, &AccCmdCount);
+        int32_t PositionResCount = (int32_t) lround(PosFixed / POSITION_PER_COUNT);
+        int32_t VelocityResCount = calcFixedPseudoDifferential(&VelocityPD, PositionResCount);
+        int32_t CurrentCmdCount = calcFixedPIDAntiWindup(&PositionGains, &PositionErrIntCount,
+                PosCmdCount - PositionResCount, VelCmdCount - VelocityResCount, 0) + calcFixedGain(AccelerationGain, AccCmdCount);
+        double CurrentFixed = CURRENT_PER_COUNT * CurrentCmdCount;
+
+        // Plant (double integrator)
+        Pos += Vel * dt_major + 0.5 * (Ktn / Mn) * Current * dt_major * dt_major;
+        Vel += (Ktn / Mn) * Current * dt_major;
+        PosFixed += VelFixed * dt_major + 0.5 * (Ktn / Mn) * CurrentFixed * dt_major * dt_major;
+        VelFixed += (Ktn / Mn) * CurrentFixed * dt_major;
+
+        MaxDiff = fmax(MaxDiff, fabs(PosFixed - Pos));
+        MaxErr = fmax(MaxErr, fabs(PosCmd - Pos));
+    }
+    printf("PositionLoop:MaxDiff:%.5f[rad],MaxTrackingErr:%.5f[rad]\n", MaxDiff, MaxErr);
+    CHECK(MaxDiff <= 2.0 * POSITION_PER_COUNT, "Position response differs by %.5f[rad]", MaxDiff);
+}
+
+/***************************************************************END OF FILE****/